@@ -3,7 +3,8 @@ open Mlui
 (* Particle explosion demo showcasing:
    - Particle systems with hundreds of independent animations
    - Simultaneous position, color, and opacity animations
-   - Physics-based motion (velocity + gravity)
+   - Physics-based motion (velocity + gravity), stepped at a fixed rate and
+     drawn between steps
    - Automatic cleanup of expired particles
 *)
 
@@ -20,12 +21,15 @@ type model = {
   particles : particle list;
   current_time : float;
   click_count : int;
+  blend : float; (* Fraction of a step since the last one *)
 }
 
 module Msg = struct
-  type t = Tick of float | Click of int * int
+  type t = Step of float | Blend of float | Click of int * int
 end
 
+let steps_per_second = 120.0
+
 (* Create animations for a single particle *)
 let make_particle_animations () =
   (* Fade out over lifetime *)
@@ -89,7 +93,7 @@ let spawn_particles x y current_time =
 
 let update msg model =
   match msg with
-  | Msg.Tick dt ->
+  | Msg.Step dt ->
       let new_time = model.current_time +. dt in
 
       (* Update particle physics *)
@@ -113,6 +117,8 @@ let update msg model =
 
       ( { model with particles = updated_particles; current_time = new_time },
         Cmd.none )
+  | Msg.Blend blend ->
+      ({ model with blend }, Cmd.none)
   | Msg.Click (x, y) ->
       let new_particles = spawn_particles x y model.current_time in
       ( {
@@ -124,6 +130,8 @@ let update msg model =
 
 let view (model : model) : Msg.t Mlui.node =
   let opacity_anim, size_anim = make_particle_animations () in
+  (* Particles are drawn where they will be this far into the next step *)
+  let ahead = model.blend /. steps_per_second in
 
   view
     ~style:
@@ -136,7 +144,7 @@ let view (model : model) : Msg.t Mlui.node =
       canvas ~style:Style.default
         (List.map
            (fun p ->
-             let elapsed = model.current_time -. p.spawn_time in
+             let elapsed = model.current_time +. ahead -. p.spawn_time in
 
              (* Evaluate animations *)
              let alpha = Animation.value_at ~time:elapsed opacity_anim in
@@ -149,7 +157,10 @@ let view (model : model) : Msg.t Mlui.node =
              in
 
              (* Draw as small circle *)
-             ellipse ~cx:p.x ~cy:p.y ~rx:size ~ry:size
+             ellipse
+               ~cx:(p.x +. (p.vx *. ahead))
+               ~cy:(p.y +. (p.vy *. ahead))
+               ~rx:size ~ry:size
                ~style:(fill color_with_alpha))
            model.particles);
     ]
@@ -157,12 +168,16 @@ let view (model : model) : Msg.t Mlui.node =
 let subscriptions _model =
   Sub.batch
     [
-      Sub.on_animation_frame (fun dt -> Msg.Tick dt);
+      Sub.on_fixed_step ~hz:steps_per_second
+        ~alpha:(fun blend -> Msg.Blend blend)
+        (fun dt -> Msg.Step dt);
       Sub.on_mouse_down (fun x y -> Msg.Click (x, y));
     ]
 
 let run () =
-  let initial_model = { particles = []; current_time = 0.0; click_count = 0 } in
+  let initial_model =
+    { particles = []; current_time = 0.0; click_count = 0; blend = 0.0 }
+  in
 
   let window =
     Window.make ~width:1024 ~height:768 ~title:"Particle Explosion Demo" ()
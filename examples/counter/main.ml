@@ -77,15 +77,15 @@ let view (model : Model.t) =
       ];
 
       view ~style:Styles.button_container [
-        view ~style:Styles.button ~on_click:(fun () -> Some Msg.Increment) [
+        view ~style:Styles.button ~on_click_msg:Msg.Increment [
           text ~style:Styles.text "Increment"
         ];
 
-        view ~style:Styles.button ~on_click:(fun () -> Some Msg.Decrement) [
+        view ~style:Styles.button ~on_click_msg:Msg.Decrement [
           text ~style:Styles.text "Decrement"
         ];
 
-        view ~style:Styles.button ~on_click:(fun () -> Some Msg.Reset) [
+        view ~style:Styles.button ~on_click_msg:Msg.Reset [
           text ~style:Styles.text "Reset"
         ]
       ]
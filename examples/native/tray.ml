@@ -13,20 +13,20 @@ module Model = struct
 end
 
 module Msg = struct
-  type t = TrayClicked
+  type t = TrayClicked | VisibilityChanged of bool
 end
 
+let tray_title visible =
+  if visible then
+    "mlui (click to hide)"
+  else
+    "mlui (click to show)"
+
 let update msg model =
   match msg with
   | Msg.TrayClicked ->
       let new_visible = not model.Model.window_visible in
-      let icon =
-        if new_visible then
-          "mlui (click to hide)"
-        else
-          "mlui (click to show)"
-      in
-      let _ = Tray.set_title model.Model.tray ~text:icon in
+      let _ = Tray.set_title model.Model.tray ~text:(tray_title new_visible) in
       let cmd =
         if new_visible then
           Cmd.focus_window
@@ -39,6 +39,10 @@ let update msg model =
          else
            "hide");
       ({ model with Model.window_visible = new_visible }, cmd)
+  | Msg.VisibilityChanged visible ->
+      (* Keeps the tray in sync when the window is minimized or closed *)
+      let _ = Tray.set_title model.Model.tray ~text:(tray_title visible) in
+      ({ model with Model.window_visible = visible }, Cmd.none)
 
 let view model =
   let status =
@@ -72,10 +76,17 @@ let view model =
         "Click the tray icon to toggle window visibility";
     ]
 
-let subscriptions model = Sub.Tray.on_click model.Model.tray Msg.TrayClicked
+let subscriptions model =
+  Sub.batch
+    [
+      Sub.Tray.on_click model.Model.tray Msg.TrayClicked;
+      Sub.on_visibility_change (fun visible -> Msg.VisibilityChanged visible);
+    ]
 
 let () =
-  let window = Window.make ~width:450 ~height:300 ~title:"Tray Demo" () in
+  let window =
+    Window.make ~width:450 ~height:300 ~title:"Tray Demo" ~background_fps:5 ()
+  in
   match run ~window ~subscriptions ~init:(Model.init ()) ~update ~view () with
   | Ok () ->
       ()
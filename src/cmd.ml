@@ -1,11 +1,18 @@
 (** Command system for side effects *)
 
-type t = None | ShowWindow | HideWindow | FocusWindow | Batch of t list
+type t =
+  | None
+  | ShowWindow
+  | HideWindow
+  | FocusWindow
+  | SetRenderScale of float
+  | Batch of t list
 
 let none = None
 let show_window = ShowWindow
 let hide_window = HideWindow
 let focus_window = FocusWindow
+let set_render_scale scale = SetRenderScale scale
 
 let batch cmds =
   let filtered = List.filter (fun c -> c <> None) cmds in
@@ -5,6 +5,7 @@ type t =
   | ShowWindow
   | HideWindow
   | FocusWindow
+  | SetRenderScale of float
   | Batch of t list
       (** Commands that the runtime can execute as side effects.
 
@@ -23,5 +24,16 @@ val hide_window : t
 val focus_window : t
 (** Command to bring the application window to front and focus it *)
 
+val set_render_scale : float -> t
+(** Render every window at a fraction of its resolution (clamped to
+    [0.1 .. 1.0]) and upscale the result, until the next idle frame. Useful
+    right before starting a heavy, fill-rate bound transition.
+
+    Example:
+    {[
+      | Msg.OpenPanel ->
+          ({ model with panel = Opening 0.0 }, Cmd.set_render_scale 0.5)
+    ]} *)
+
 val batch : t list -> t
 (** Combine multiple commands into one *)
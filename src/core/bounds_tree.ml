@@ -0,0 +1,217 @@
+(* Operations on the structure-of-arrays bounds tree (see Types.bounds_tree).
+   A window keeps two trees and alternates between them, so the previous
+   frame's entries stay readable while the next frame is laid out and
+   unchanged subtrees can be copied over as a range. *)
+
+open Types
+
+let none = -1
+
+(* Tree generations are unique across all trees, so a recorded
+   (generation, start) pair can only ever refer to one tree's contents *)
+let next_generation = Atomic.make 0
+
+let fresh_generation () = Atomic.fetch_and_add next_generation 1
+
+let create () =
+  {
+    length = 0;
+    generation = fresh_generation ();
+    xs = Float.Array.create 0;
+    ys = Float.Array.create 0;
+    widths = Float.Array.create 0;
+    heights = Float.Array.create 0;
+    parents = [||];
+    first_children = [||];
+    next_siblings = [||];
+    indices = [||];
+    nodes = [||];
+  }
+
+let is_empty tree = tree.length = 0
+
+(* Starts a new layout. Node references are dropped so last frame's views
+   are not kept alive by a larger, earlier frame. *)
+let clear tree =
+  Array.fill tree.nodes 0 tree.length Empty;
+  tree.length <- 0;
+  tree.generation <- fresh_generation ()
+
+let reserve tree needed =
+  let capacity = Array.length tree.parents in
+  if needed > capacity then begin
+    let capacity = max needed (max 64 (capacity * 2)) in
+    let grow_floats floats =
+      let grown = Float.Array.create capacity in
+      Float.Array.blit floats 0 grown 0 tree.length;
+      grown
+    in
+    let grow_ints ints =
+      let grown = Array.make capacity none in
+      Array.blit ints 0 grown 0 tree.length;
+      grown
+    in
+    let nodes = Array.make capacity Empty in
+    Array.blit tree.nodes 0 nodes 0 tree.length;
+    tree.xs <- grow_floats tree.xs;
+    tree.ys <- grow_floats tree.ys;
+    tree.widths <- grow_floats tree.widths;
+    tree.heights <- grow_floats tree.heights;
+    tree.parents <- grow_ints tree.parents;
+    tree.first_children <- grow_ints tree.first_children;
+    tree.next_siblings <- grow_ints tree.next_siblings;
+    tree.indices <- grow_ints tree.indices;
+    tree.nodes <- nodes
+  end
+
+(* Hooks [entry] up as the child of [parent] that follows [after] *)
+let link tree ~parent ~after entry =
+  if after <> none then
+    tree.next_siblings.(after) <- entry
+  else if parent <> none then
+    tree.first_children.(parent) <- entry
+
+(* Appends a node without children and returns its entry *)
+let add tree ~parent ~after ~index node ~x ~y ~width ~height =
+  reserve tree (tree.length + 1);
+  let entry = tree.length in
+  Float.Array.set tree.xs entry x;
+  Float.Array.set tree.ys entry y;
+  Float.Array.set tree.widths entry width;
+  Float.Array.set tree.heights entry height;
+  tree.parents.(entry) <- parent;
+  tree.first_children.(entry) <- none;
+  tree.next_siblings.(entry) <- none;
+  tree.indices.(entry) <- index;
+  tree.nodes.(entry) <- node;
+  tree.length <- entry + 1;
+  link tree ~parent ~after entry;
+  entry
+
+(* Appends a copy of the subtree of [source] at [start], [length] entries
+   long, moved by ([dx], [dy]), and returns the entry of its root *)
+let copy tree ~parent ~after ~index ~dx ~dy source ~start ~length =
+  reserve tree (tree.length + length);
+  let first = tree.length in
+  let shift = first - start in
+  let shifted entry =
+    if entry = none then
+      none
+    else
+      entry + shift
+  in
+  for k = 0 to length - 1 do
+    let from = start + k in
+    let entry = first + k in
+    Float.Array.set tree.xs entry (Float.Array.get source.xs from +. dx);
+    Float.Array.set tree.ys entry (Float.Array.get source.ys from +. dy);
+    Float.Array.set tree.widths entry (Float.Array.get source.widths from);
+    Float.Array.set tree.heights entry (Float.Array.get source.heights from);
+    tree.first_children.(entry) <- shifted source.first_children.(from);
+    tree.nodes.(entry) <- source.nodes.(from);
+    if k = 0 then begin
+      tree.parents.(entry) <- parent;
+      tree.next_siblings.(entry) <- none;
+      tree.indices.(entry) <- index
+    end
+    else begin
+      tree.parents.(entry) <- shifted source.parents.(from);
+      tree.next_siblings.(entry) <- shifted source.next_siblings.(from);
+      tree.indices.(entry) <- source.indices.(from)
+    end
+  done;
+  tree.length <- first + length;
+  link tree ~parent ~after first;
+  first
+
+let node tree entry = tree.nodes.(entry)
+
+let bounds tree entry =
+  {
+    x = Float.Array.get tree.xs entry;
+    y = Float.Array.get tree.ys entry;
+    width = Float.Array.get tree.widths entry;
+    height = Float.Array.get tree.heights entry;
+  }
+
+let contains tree entry x y =
+  let left = Float.Array.get tree.xs entry in
+  let top = Float.Array.get tree.ys entry in
+  x >= left
+  && x < left +. Float.Array.get tree.widths entry
+  && y >= top
+  && y < top +. Float.Array.get tree.heights entry
+
+(* Deepest entry containing the point, later siblings first since they are
+   drawn on top, or [none] *)
+let find_at tree x y =
+  let rec in_subtree entry =
+    let found = in_children tree.first_children.(entry) in
+    if found <> none then
+      found
+    else if contains tree entry x y then
+      entry
+    else
+      none
+  and in_children child =
+    if child = none then
+      none
+    else
+      let found = in_children tree.next_siblings.(child) in
+      if found <> none then
+        found
+      else
+        in_subtree child
+  in
+  if is_empty tree then
+    none
+  else
+    in_subtree 0
+
+(* Entry at [path], following child positions from the root, or [none] *)
+let find_by_path tree path =
+  let rec nth_child child n =
+    if child = none || n = 0 then
+      child
+    else
+      nth_child tree.next_siblings.(child) (n - 1)
+  in
+  let rec follow entry = function
+    | [] ->
+        entry
+    | index :: rest ->
+        let child =
+          if index < 0 then
+            none
+          else
+            nth_child tree.first_children.(entry) index
+        in
+        if child = none then
+          none
+        else
+          follow child rest
+  in
+  if is_empty tree then
+    none
+  else
+    follow 0 path
+
+let path_of tree entry =
+  let rec up entry path =
+    let parent = tree.parents.(entry) in
+    if parent = none then
+      path
+    else
+      up parent (tree.indices.(entry) :: path)
+  in
+  up entry []
+
+let depth tree entry =
+  let rec up entry depth =
+    let parent = tree.parents.(entry) in
+    if parent = none then
+      depth
+    else
+      up parent (depth + 1)
+  in
+  up entry 0
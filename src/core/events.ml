@@ -8,112 +8,129 @@ let point_in_bounds (pos : Position.t) (bounds : bounds) : bool =
   && y >= bounds.y
   && y < bounds.y +. bounds.height
 
-let rec find_node_at_position (pos : Position.t)
-    (node_with_bounds : 'msg node_with_bounds) : 'msg node_with_bounds option =
-  let rec check_children = function
-    | [] ->
-        None
-    | child :: rest -> (
-        match find_node_at_position pos child with
-        | Some result ->
-            Some result
-        | None ->
-            check_children rest)
-  in
-  match check_children (List.rev node_with_bounds.children) with
-  | Some result ->
-      Some result
-  | None ->
-      if point_in_bounds pos node_with_bounds.bounds then
-        Some node_with_bounds
-      else
-        None
+(* Entry of the deepest node at [pos], or [Bounds_tree.none] *)
+let find_node_at_position (pos : Position.t) (tree : 'msg bounds_tree) : int =
+  Bounds_tree.find_at tree (float_of_int pos.x) (float_of_int pos.y)
+
+let find_node_by_path (path : path) (tree : 'msg bounds_tree) : int =
+  Bounds_tree.find_by_path tree path
 
-let rec find_node_by_path (path : path)
-    (node_with_bounds : 'msg node_with_bounds) : 'msg node_with_bounds option =
-  match path with
-  | [] ->
-      Some node_with_bounds
-  | index :: rest -> (
-      let rec nth idx = function
-        | [] ->
-            None
-        | child :: tail ->
-            if idx = 0 then
-              Some child
-            else
-              nth (idx - 1) tail
+let click_message (type msg) (click : msg click) : msg option =
+  match click with
+  | No_click ->
+      None
+  | Click handler ->
+      handler ()
+  | Click_msg msg ->
+      Some msg
+  | Click_with (handler, payload) ->
+      handler payload
+
+let pointer_message (type msg) (pointer : msg pointer) position : msg option =
+  match pointer with
+  | No_pointer ->
+      None
+  | Pointer handler ->
+      handler position
+  | Pointer_msg msg ->
+      Some msg
+  | Pointer_with (handler, payload) ->
+      handler payload position
+
+(* A left press goes to [on_click] before [on_mouse_down] when
+   [click_first], as on views and texts; canvases only fall back to it *)
+let rec handlers_message :
+    type msg.
+    click_first:bool -> Ui_event.t -> int * int -> msg handlers -> msg option =
+ fun ~click_first event position handlers ->
+  match handlers with
+  | Mapped (f, handlers) ->
+      Option.map f (handlers_message ~click_first event position handlers)
+  | Handlers handlers -> (
+      let pointer =
+        match event with
+        | Ui_event.MouseDown _ ->
+            handlers.on_mouse_down
+        | Ui_event.MouseUp _ ->
+            handlers.on_mouse_up
+        | Ui_event.MouseMove _ ->
+            handlers.on_mouse_move
+        | Ui_event.MouseEnter _ ->
+            handlers.on_mouse_enter
+        | Ui_event.MouseLeave _ ->
+            handlers.on_mouse_leave
+        | _ ->
+            No_pointer
       in
-      match nth index node_with_bounds.children with
-      | Some child ->
-          find_node_by_path rest child
-      | None ->
-          None)
+      match (event, handlers.on_click, pointer) with
+      | ( Ui_event.MouseDown { button = Ui_event.Left; _ },
+          (Click _ | Click_msg _ | Click_with _),
+          _ )
+        when click_first ->
+          click_message handlers.on_click
+      | Ui_event.MouseDown { button = Ui_event.Left; _ }, click, No_pointer ->
+          click_message click
+      | _ ->
+          pointer_message pointer position)
 
 let handle_node_event_with_bounds (event : Ui_event.t)
     (node : 'msg interactive_node) (bounds : bounds) : 'msg option =
-  let transform_coords x y =
-    let rel_x = float_of_int x -. bounds.x in
-    let rel_y = float_of_int y -. bounds.y in
-    (int_of_float rel_x, int_of_float rel_y)
+  let position =
+    match event with
+    | Ui_event.MouseDown { x; y; _ }
+    | Ui_event.MouseUp { x; y; _ }
+    | Ui_event.MouseMove { x; y }
+    | Ui_event.MouseEnter { x; y }
+    | Ui_event.MouseLeave { x; y } ->
+        Some
+          ( int_of_float (float_of_int x -. bounds.x),
+            int_of_float (float_of_int y -. bounds.y) )
+    | _ ->
+        None
   in
-  match (event, node) with
-  | ( Ui_event.MouseDown { button = Ui_event.Left; _ },
-      View { on_click = Some handler; _ } ) ->
-      handler ()
-  | Ui_event.MouseDown { x; y; _ }, View { on_mouse_down = Some handler; _ }
-  | Ui_event.MouseUp { x; y; _ }, View { on_mouse_up = Some handler; _ }
-  | Ui_event.MouseMove { x; y }, View { on_mouse_move = Some handler; _ }
-  | Ui_event.MouseEnter { x; y }, View { on_mouse_enter = Some handler; _ }
-  | Ui_event.MouseLeave { x; y }, View { on_mouse_leave = Some handler; _ }
-  | Ui_event.MouseDown { x; y; _ }, Canvas { on_mouse_down = Some handler; _ }
-  | Ui_event.MouseUp { x; y; _ }, Canvas { on_mouse_up = Some handler; _ }
-  | Ui_event.MouseMove { x; y }, Canvas { on_mouse_move = Some handler; _ }
-  | Ui_event.MouseEnter { x; y }, Canvas { on_mouse_enter = Some handler; _ }
-  | Ui_event.MouseLeave { x; y }, Canvas { on_mouse_leave = Some handler; _ } ->
-      let rel_x, rel_y = transform_coords x y in
-      handler (rel_x, rel_y)
-  | ( Ui_event.MouseDown { button = Ui_event.Left; _ },
-      Canvas { on_click = Some handler; _ } ) ->
-      handler ()
-  | ( Ui_event.MouseDown { button = Ui_event.Left; _ },
-      Text { on_click = Some handler; _ } ) ->
-      handler ()
+  match (position, node) with
+  | Some position, (View { handlers; _ } | Text { handlers; _ }) ->
+      handlers_message ~click_first:true event position handlers
+  | ( Some position,
+      (Canvas { handlers; _ } | Raster { handlers; _ } | Editor { handlers; _ })
+    ) ->
+      handlers_message ~click_first:false event position handlers
   | _ ->
       None
 
+(* [dispatch_to_node event entry] delivers [event] to the node at [entry].
+   The hovered node is remembered by path, which is only built when the
+   pointer enters a new node. *)
 let handle_mouse_motion ~tree ~hovered_path ~dispatch_to_node
     (move : Ui_event.t) =
   match move with
   | Ui_event.MouseMove { x; y } ->
       let pos = Position.make ~x ~y in
-      let current_node = find_node_at_position pos tree in
+      let current = find_node_at_position pos tree in
       let handled = ref false in
-      let dispatch event node_info =
-        if dispatch_to_node event node_info then handled := true
+      let dispatch event entry =
+        if dispatch_to_node event entry then handled := true
       in
       (match !hovered_path with
-      | Some prev_path -> (
-          match current_node with
-          | Some node when node.path = prev_path ->
-              ()
-          | _ -> (
-              match find_node_by_path prev_path tree with
-              | Some prev_node ->
-                  dispatch (Ui_event.MouseLeave { x; y }) prev_node;
-                  hovered_path := None
-              | None ->
-                  hovered_path := None))
+      | Some prev_path ->
+          let previous = find_node_by_path prev_path tree in
+          if previous = Bounds_tree.none then
+            hovered_path := None
+          else if previous <> current then begin
+            dispatch (Ui_event.MouseLeave { x; y }) previous;
+            hovered_path := None
+          end
       | None ->
           ());
-      (match current_node with
-      | Some node ->
-          if Some node.path <> !hovered_path then
-            dispatch (Ui_event.MouseEnter { x; y }) node;
-          hovered_path := Some node.path;
-          dispatch move node
-      | None ->
-          hovered_path := None);
+      if current <> Bounds_tree.none then begin
+        if Option.is_none !hovered_path then begin
+          dispatch (Ui_event.MouseEnter { x; y }) current;
+          hovered_path := Some (Bounds_tree.path_of tree current)
+        end;
+        dispatch move current
+      end
+      else
+        hovered_path := None;
       !handled
   | _ ->
       false
@@ -0,0 +1,145 @@
+open Tgles2
+
+(* Textured quads drawn with a minimal shader, for pixels that do not go
+   through Wall (e.g. upscaling an offscreen render target). *)
+
+let bigarray_create kind len = Bigarray.(Array1.create kind c_layout len)
+
+let get_int =
+  let a = bigarray_create Bigarray.int32 1 in
+  fun f ->
+    f a;
+    Int32.to_int a.{0}
+
+let set_int =
+  let a = bigarray_create Bigarray.int32 1 in
+  fun f i ->
+    a.{0} <- Int32.of_int i;
+    f a
+
+let vertex_shader =
+  {|
+attribute vec2 a_position;
+attribute vec2 a_uv;
+varying vec2 v_uv;
+void main() {
+  v_uv = a_uv;
+  gl_Position = vec4(a_position, 0.0, 1.0);
+}
+|}
+
+let fragment_shader =
+  {|
+#ifdef GL_ES
+precision mediump float;
+#endif
+uniform sampler2D u_texture;
+varying vec2 v_uv;
+void main() {
+  gl_FragColor = texture2D(u_texture, v_uv);
+}
+|}
+
+type program = {
+  id : int;
+  position : int;
+  uv : int;
+  sampler : int;
+  buffer : int;
+  vertices : (float, Bigarray.float32_elt, Bigarray.c_layout) Bigarray.Array1.t;
+}
+
+let compile kind source =
+  let shader = Gl.create_shader kind in
+  Gl.shader_source shader source;
+  Gl.compile_shader shader;
+  if get_int (Gl.get_shaderiv shader Gl.compile_status) = 0 then begin
+    Gl.delete_shader shader;
+    failwith "Gl_quad: shader compilation failed"
+  end;
+  shader
+
+let create_program () =
+  let vertex = compile Gl.vertex_shader vertex_shader in
+  let fragment = compile Gl.fragment_shader fragment_shader in
+  let id = Gl.create_program () in
+  Gl.attach_shader id vertex;
+  Gl.attach_shader id fragment;
+  Gl.link_program id;
+  Gl.delete_shader vertex;
+  Gl.delete_shader fragment;
+  if get_int (Gl.get_programiv id Gl.link_status) = 0 then
+    failwith "Gl_quad: program link failed";
+  {
+    id;
+    position = Gl.get_attrib_location id "a_position";
+    uv = Gl.get_attrib_location id "a_uv";
+    sampler = Gl.get_uniform_location id "u_texture";
+    buffer = get_int (Gl.gen_buffers 1);
+    vertices = bigarray_create Bigarray.float32 16;
+  }
+
+(* Created on first use, with the (shared) GL context current *)
+let program =
+  lazy
+    (try Some (create_program ())
+     with Failure msg ->
+       Printf.eprintf "Warning: %s\n" msg;
+       None)
+
+let create_texture ~filter =
+  let id = get_int (Gl.gen_textures 1) in
+  Gl.bind_texture Gl.texture_2d id;
+  Gl.tex_parameteri Gl.texture_2d Gl.texture_min_filter filter;
+  Gl.tex_parameteri Gl.texture_2d Gl.texture_mag_filter filter;
+  Gl.tex_parameteri Gl.texture_2d Gl.texture_wrap_s Gl.clamp_to_edge;
+  Gl.tex_parameteri Gl.texture_2d Gl.texture_wrap_t Gl.clamp_to_edge;
+  id
+
+let delete_texture id = set_int (Gl.delete_textures 1) id
+
+(* Draws [texture] over the pixel rectangle [x, y, w, h] of a viewport of
+   [viewport_width] x [viewport_height] with a top-left origin. [uv] gives the
+   texture coordinates of the top-left and bottom-right corners. *)
+let draw ~texture ~viewport_width ~viewport_height ~x ~y ~w ~h
+    ~uv:(u0, v0, u1, v1) ~blend =
+  match Lazy.force program with
+  | None ->
+      ()
+  | Some p ->
+      let ndc_x px = (px /. viewport_width *. 2.0) -. 1.0 in
+      let ndc_y py = 1.0 -. (py /. viewport_height *. 2.0) in
+      let left = ndc_x x and right = ndc_x (x +. w) in
+      let top = ndc_y y and bottom = ndc_y (y +. h) in
+      let set i px py u v =
+        p.vertices.{i * 4} <- px;
+        p.vertices.{(i * 4) + 1} <- py;
+        p.vertices.{(i * 4) + 2} <- u;
+        p.vertices.{(i * 4) + 3} <- v
+      in
+      set 0 left top u0 v0;
+      set 1 left bottom u0 v1;
+      set 2 right top u1 v0;
+      set 3 right bottom u1 v1;
+      Gl.disable Gl.stencil_test;
+      Gl.disable Gl.scissor_test;
+      if blend then begin
+        Gl.enable Gl.blend;
+        Gl.blend_func Gl.src_alpha Gl.one_minus_src_alpha
+      end
+      else
+        Gl.disable Gl.blend;
+      Gl.use_program p.id;
+      Gl.active_texture Gl.texture0;
+      Gl.bind_texture Gl.texture_2d texture;
+      Gl.uniform1i p.sampler 0;
+      Gl.bind_buffer Gl.array_buffer p.buffer;
+      Gl.buffer_data Gl.array_buffer (16 * 4) (Some p.vertices) Gl.stream_draw;
+      Gl.enable_vertex_attrib_array p.position;
+      Gl.vertex_attrib_pointer p.position 2 Gl.float false 16 (`Offset 0);
+      Gl.enable_vertex_attrib_array p.uv;
+      Gl.vertex_attrib_pointer p.uv 2 Gl.float false 16 (`Offset 8);
+      Gl.draw_arrays Gl.triangle_strip 0 4;
+      Gl.disable_vertex_attrib_array p.position;
+      Gl.disable_vertex_attrib_array p.uv;
+      Gl.bind_buffer Gl.array_buffer 0
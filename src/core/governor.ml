@@ -0,0 +1,64 @@
+(* Adaptive quality governor: averages frame times over a fixed number of
+   frames and steps between quality tiers with hysteresis. Stepping down is
+   immediate once a sample window runs over budget; stepping up needs several
+   consecutive windows with headroom, so a tier that was just too slow is not
+   retried every other second. *)
+
+type t = {
+  config : Quality.config;
+  budget_ms : float;
+  mutable tier : Quality.tier;
+  mutable sum_ms : float;
+  mutable samples : int;
+  mutable good_windows : int;
+}
+
+let create (config : Quality.config) =
+  {
+    config;
+    budget_ms = 1000.0 /. config.target_fps;
+    tier = Quality.High;
+    sum_ms = 0.0;
+    samples = 0;
+    good_windows = 0;
+  }
+
+let tier t = t.tier
+
+(* Records one frame. Returns the new tier when it changed. *)
+let observe t ~frame_ms =
+  t.sum_ms <- t.sum_ms +. frame_ms;
+  t.samples <- t.samples + 1;
+  if t.samples < t.config.sample_frames then
+    None
+  else begin
+    let average = t.sum_ms /. float_of_int t.samples in
+    t.sum_ms <- 0.0;
+    t.samples <- 0;
+    let change =
+      if average > t.budget_ms *. t.config.downgrade_ratio then begin
+        t.good_windows <- 0;
+        match Quality.lower t.tier with
+        | Some lower
+          when Quality.rank lower <= Quality.rank t.config.lowest_tier ->
+            Some lower
+        | _ ->
+            None
+      end
+      else if average < t.budget_ms *. t.config.upgrade_ratio then begin
+        t.good_windows <- t.good_windows + 1;
+        if t.good_windows >= t.config.upgrade_after then begin
+          t.good_windows <- 0;
+          Quality.higher t.tier
+        end
+        else
+          None
+      end
+      else begin
+        t.good_windows <- 0;
+        None
+      end
+    in
+    Option.iter (fun tier -> t.tier <- tier) change;
+    change
+  end
@@ -144,36 +144,245 @@ module FlexIntegrationImpl = struct
             FlexLayoutEngine.LayoutSupport.defaultStyle.paddingBottom);
     }
 
-  let is_absolutely_positioned ui_node =
+  let rec node_style (ui_node : 'msg interactive_node) =
     match ui_node with
-    | View { style; _ } | Text { style; _ } | Canvas { style; _ } ->
-        style.position_type = Some Absolute
+    | View { style; _ }
+    | Text { style; _ }
+    | Canvas { style; _ }
+    | Chart { style; _ }
+    | Raster { style; _ }
+    | Editor { style; _ } ->
+        style
+    | Static ({ pinned_width = None; pinned_height = None; _ } as static) ->
+        node_style (static_content static)
+    | Static
+        ({ pinned_width = Some _ as width; pinned_height = Some _ as height; _ }
+         as static) ->
+        (* Pinned on both sides, so flex neither grows nor shrinks it *)
+        {
+          (node_style (static_content static)) with
+          width;
+          height;
+          flex_grow = None;
+          flex_shrink = Some 0.0;
+          flex_basis = None;
+        }
+    | Static ({ pinned_width; pinned_height; _ } as static) ->
+        let style = node_style (static_content static) in
+        let pin size ~default = if Option.is_some size then size else default in
+        {
+          style with
+          width = pin pinned_width ~default:style.width;
+          height = pin pinned_height ~default:style.height;
+        }
     | Empty ->
+        Style.default
+
+  let is_absolutely_positioned ui_node =
+    (node_style ui_node).position_type = Some Absolute
+
+  (* Children selected by [keep], in order. Returns [children] itself when all
+     are kept, which is the common case for both selections below. *)
+  let select_children keep (children : 'msg interactive_node array) =
+    let count =
+      Array.fold_left
+        (fun count child ->
+          if keep child then
+            count + 1
+          else
+            count)
+        0 children
+    in
+    if count = Array.length children then
+      children
+    else if count = 0 then
+      [||]
+    else begin
+      let selected = Array.make count Empty in
+      let next = ref 0 in
+      Array.iter
+        (fun child ->
+          if keep child then begin
+            selected.(!next) <- child;
+            incr next
+          end)
+        children;
+      selected
+    end
+
+  let relative_children children =
+    select_children (fun child -> not (is_absolutely_positioned child)) children
+
+  let absolute_children children =
+    select_children is_absolutely_positioned children
+
+  (* Charts and editors draw from a mutable series or text buffer, so what
+     they draw can change while the node stays the same *)
+  let rec is_live (ui_node : 'msg interactive_node) =
+    match ui_node with
+    | Chart _ | Editor _ ->
+        true
+    | View { children; _ } ->
+        Array.exists is_live children
+    | Text _ | Canvas _ | Raster _ | Static _ | Empty ->
         false
 
-  let rec create_flex_node (ui_node : 'msg interactive_node) : FlexTypes.node =
+  let node_key (ui_node : 'msg interactive_node) =
     match ui_node with
-    | Empty ->
-        FlexLayoutSupport.createNode ~withChildren:[||]
-          ~andStyle:(style_to_flex_style Style.default)
-          ()
-    | Text { style; _ } | Canvas { style; _ } ->
-        FlexLayoutSupport.createNode ~withChildren:[||]
-          ~andStyle:(style_to_flex_style style)
-          ()
-    | View { style; children; _ } ->
-        (* Filter out absolutely positioned children *)
-        let relative_children =
-          List.filter
-            (fun child -> not (is_absolutely_positioned child))
-            children
+    | View { key; _ }
+    | Text { key; _ }
+    | Canvas { key; _ }
+    | Chart { key; _ }
+    | Raster { key; _ }
+    | Editor { key; _ } ->
+        key
+    | Static _ | Empty ->
+        None
+
+  (* A node paired with its flex node and with what it produced the last time
+     it was placed. Kept from one frame to the next, so a child that is
+     physically equal to last frame's child at the same key or position brings
+     its flex subtree (and the flex layout cache in it) and its bounds and
+     primitives along instead of being rebuilt. *)
+  type 'msg retained = {
+    ui : 'msg interactive_node;
+    flex : FlexTypes.node;
+    children : 'msg retained array;  (* Relative children, in flex order *)
+    mutable pass : unit ref;  (* Layout pass that last claimed this node *)
+    live : bool;  (* Contains a chart or editor; primitives are never reused *)
+    (* Box and decorative flag the subtree's primitives were last made for,
+       and where they went in the buffer of frame [primitives_frame] *)
+    mutable placed_box : bounds;
+    mutable placed_decorative : bool;
+    mutable primitives_frame : int;
+    mutable primitives_start : int;
+    mutable primitives_length : int;
+    (* Where the subtree's entries went in the bounds tree it was last placed
+       in; [span_generation] is that tree's generation *)
+    mutable span_generation : int;
+    mutable span_start : int;
+    mutable span_length : int;
+  }
+
+  let unplaced = { x = 0.0; y = 0.0; width = 0.0; height = 0.0 }
+
+  (* Pairs [ui_node] with flex nodes, reusing subtrees of [previous] that are
+     physically equal. A previous node is claimed by at most one node per
+     pass, so a flex node never ends up twice in the same tree. *)
+  let rec retain ?previous ~pass (ui_node : 'msg interactive_node) :
+      'msg retained =
+    match previous with
+    | Some previous when previous.ui == ui_node && previous.pass != pass ->
+        previous.pass <- pass;
+        previous
+    | _ -> (
+        let previous =
+          match previous with
+          | Some previous when previous.pass != pass ->
+              previous.pass <- pass;
+              Some previous
+          | _ ->
+              None
         in
-        let flex_children =
-          Array.of_list (List.map create_flex_node relative_children)
+        let leaf style =
+          {
+            ui = ui_node;
+            flex =
+              FlexLayoutSupport.createNode ~withChildren:[||]
+                ~andStyle:(style_to_flex_style style)
+                ();
+            children = [||];
+            pass;
+            live = is_live ui_node;
+            placed_box = unplaced;
+            placed_decorative = false;
+            primitives_frame = -1;
+            primitives_start = 0;
+            primitives_length = 0;
+            span_generation = -1;
+            span_start = 0;
+            span_length = 0;
+          }
         in
-        FlexLayoutSupport.createNode ~withChildren:flex_children
-          ~andStyle:(style_to_flex_style style)
-          ()
+        match ui_node with
+        | Empty ->
+            leaf Style.default
+        | Text { style; _ }
+        | Canvas { style; _ }
+        | Chart { style; _ }
+        | Raster { style; _ }
+        | Editor { style; _ } ->
+            leaf style
+        | Static _ ->
+            (* Static content is laid out on its own, in the box this leaf
+               gets *)
+            leaf (node_style ui_node)
+        | View { style; children = ui_children; _ } ->
+            (* Filter out absolutely positioned children *)
+            let relative_children = relative_children ui_children in
+            let previous_children =
+              match previous with
+              | Some previous ->
+                  previous.children
+              | None ->
+                  [||]
+            in
+            let keyed =
+              lazy
+                (let table = Hashtbl.create 16 in
+                 Array.iter
+                   (fun child ->
+                     match node_key child.ui with
+                     | Some key ->
+                         Hashtbl.replace table key child
+                     | None ->
+                         ())
+                   previous_children;
+                 table)
+            in
+            let previous_child i child =
+              match node_key child with
+              | Some key ->
+                  Hashtbl.find_opt (Lazy.force keyed) key
+              | None when i < Array.length previous_children ->
+                  Some previous_children.(i)
+              | None ->
+                  None
+            in
+            let children =
+              Array.mapi
+                (fun i child ->
+                  retain ?previous:(previous_child i child) ~pass child)
+                relative_children
+            in
+            {
+              ui = ui_node;
+              flex =
+                FlexLayoutSupport.createNode
+                  ~withChildren:(Array.map (fun child -> child.flex) children)
+                  ~andStyle:(style_to_flex_style style)
+                  ();
+              children;
+              pass;
+              live =
+                Array.exists (fun child -> child.live) children
+                || Array.exists is_live (absolute_children ui_children);
+              placed_box = unplaced;
+              placed_decorative = false;
+              primitives_frame = -1;
+              primitives_start = 0;
+              primitives_length = 0;
+              span_generation = -1;
+              span_start = 0;
+              span_length = 0;
+            })
+
+  (* Each layout gets its own flex context, so independent trees can be laid
+     out from different domains at the same time *)
+  let layout_flex flex ~width ~height =
+    FlexLayoutEngine.layoutNode
+      (FlexLayoutEngine.createContext ())
+      flex width height FlexTypes.Ltr
 
   let get_layout_info (node : FlexTypes.node) : bounds =
     let open FlexTypes in
@@ -209,254 +418,308 @@ module FlexIntegrationImpl = struct
     | _ ->
         (0.0, 0.0)
 
-  let rec apply_layout_to_ui_node ?(offset_x = 0.0) ?(offset_y = 0.0)
-      (flex_node : FlexTypes.node) (ui_node : 'msg interactive_node) :
-      render_primitive list =
-    let layout_bounds = get_layout_info flex_node in
-
-    (* Get style and apply transform *)
+  let translate_primitive ~dx ~dy (primitive : render_primitive) =
+    let bounds =
+      {
+        primitive.bounds with
+        x = primitive.bounds.x +. dx;
+        y = primitive.bounds.y +. dy;
+      }
+    in
+    let shape =
+      match primitive.shape with
+      | `Path points ->
+          `Path (List.map (fun (px, py) -> (px +. dx, py +. dy)) points)
+      | shape ->
+          shape
+    in
     let style =
-      match ui_node with
-      | View { style; _ } ->
-          style
-      | Text { style; _ } ->
-          style
-      | Canvas { style; _ } ->
+      match primitive.style with
+      | RenderStyle.Text (color, content, _, _, font_size) ->
+          RenderStyle.Text
+            ( color,
+              content,
+              int_of_float bounds.x,
+              int_of_float bounds.y,
+              font_size )
+      | style ->
           style
-      | Empty ->
-          Style.default
     in
+    { primitive with bounds; shape; style }
+
+  let render_style_of_primitive_style = function
+    | Fill color ->
+        RenderStyle.Fill color
+    | Stroke (color, w) ->
+        RenderStyle.Stroke (color, w)
+    | FillAndStroke (fill, stroke, w) ->
+        RenderStyle.FillAndStroke (fill, stroke, w)
+
+  (* A canvas primitive moved to the canvas origin at ([x], [y]) *)
+  let canvas_primitive ~x:origin_x ~y:origin_y ~decorative primitive =
+    match primitive with
+    | Rectangle { x; y; width; height; style } ->
+        {
+          bounds = { x = origin_x +. x; y = origin_y +. y; width; height };
+          shape = `Rectangle;
+          style = render_style_of_primitive_style style;
+          decorative;
+        }
+    | Ellipse { cx; cy; rx; ry; style } ->
+        {
+          bounds =
+            {
+              x = origin_x +. cx -. rx;
+              y = origin_y +. cy -. ry;
+              width = rx *. 2.0;
+              height = ry *. 2.0;
+            };
+          shape = `Ellipse;
+          style = render_style_of_primitive_style style;
+          decorative;
+        }
+    | Path { points; style } ->
+        let offset_points =
+          List.map (fun (px, py) -> (px +. origin_x, py +. origin_y)) points
+        in
+        let bounds =
+          match offset_points with
+          | [] ->
+              { x = origin_x; y = origin_y; width = 0.0; height = 0.0 }
+          | _ ->
+              let xs = List.map fst offset_points in
+              let ys = List.map snd offset_points in
+              let min_x = List.fold_left min (List.hd xs) xs in
+              let max_x = List.fold_left max (List.hd xs) xs in
+              let min_y = List.fold_left min (List.hd ys) ys in
+              let max_y = List.fold_left max (List.hd ys) ys in
+              {
+                x = min_x;
+                y = min_y;
+                width = max_x -. min_x;
+                height = max_y -. min_y;
+              }
+        in
+        {
+          bounds;
+          shape = `Path offset_points;
+          style = render_style_of_primitive_style style;
+          decorative;
+        }
+
+  (* Appends the background of a view or canvas, if it has one *)
+  let push_background buffer ~decorative (style : Style.t) bounds =
+    match style.background_color with
+    | None ->
+        ()
+    | Some bg_color ->
+        let bg_style =
+          match (style.border_color, style.border_width) with
+          | Some border_color, Some border_width ->
+              RenderStyle.FillAndStroke (bg_color, border_color, border_width)
+          | _ ->
+              RenderStyle.Fill bg_color
+        in
+        Primitive_buffer.push buffer
+          {
+            bounds;
+            shape =
+              (match style.border_radius with
+              | Some radius ->
+                  `RoundedRectangle radius
+              | None ->
+                  `Rectangle);
+            style = bg_style;
+            decorative;
+          }
+
+  let push_text buffer ~decorative ~(bounds : bounds) content
+      (style : Style.t) =
+    let font_size = Option.value style.font_size ~default:12.0 in
+    let text_color =
+      Option.value style.text_color ~default:(Color.make ~r:0 ~g:0 ~b:0 ())
+    in
+    Primitive_buffer.push buffer
+      {
+        bounds;
+        shape = `Rectangle;
+        style =
+          RenderStyle.Text
+            ( text_color,
+              content,
+              int_of_float bounds.x,
+              int_of_float bounds.y,
+              font_size );
+        decorative;
+      }
+
+  let push_canvas buffer ~decorative ~(bounds : bounds) primitives style =
+    push_background buffer ~decorative style bounds;
+    List.iter
+      (fun primitive ->
+        Primitive_buffer.push buffer
+          (canvas_primitive ~x:bounds.x ~y:bounds.y ~decorative primitive))
+      primitives
+
+  (* Appends a chart, decimated to the columns of its box *)
+  let push_chart buffer ~decorative ~(bounds : bounds) series style ~color
+      ~line_width ~y_range =
+    push_background buffer ~decorative style bounds;
+    Primitive_buffer.push buffer
+      {
+        bounds;
+        shape =
+          `Polyline
+            (Series.decimate series ~width:bounds.width ~height:bounds.height
+               ~y_range);
+        style = RenderStyle.Stroke (color, line_width);
+        decorative;
+      }
+
+  (* Appends a raster. Its pixels are uploaded when it is drawn, so the
+     primitive stays valid while the raster changes. *)
+  let push_raster buffer ~decorative ~(bounds : bounds) raster style =
+    push_background buffer ~decorative style bounds;
+    Primitive_buffer.push buffer
+      {
+        bounds;
+        shape = `Raster raster;
+        style = RenderStyle.Fill Color.transparent;
+        decorative;
+      }
+
+  (* Appends the lines of an editor that fit its box, and its caret *)
+  let push_editor buffer ~decorative ~(bounds : bounds) editor
+      (style : Style.t) =
+    push_background buffer ~decorative style bounds;
+    let font_size = Option.value style.font_size ~default:12.0 in
+    let text_color =
+      Option.value style.text_color ~default:(Color.make ~r:0 ~g:0 ~b:0 ())
+    in
+    let line_height = Text_editor.line_height ~font_size in
+    let text = Text_editor.buffer editor in
+    let first_line = Text_editor.first_line editor in
+    let count =
+      min
+        (int_of_float (bounds.height /. line_height))
+        (Text_buffer.line_count text - first_line)
+    in
+    let lines =
+      Array.init (max 0 count) (fun row ->
+          Text_buffer.line text (first_line + row))
+    in
+    let caret =
+      let line, column = Text_editor.cursor_position editor in
+      if line >= first_line && line < first_line + Array.length lines then
+        Some (line - first_line, column)
+      else
+        None
+    in
+    Primitive_buffer.push buffer
+      {
+        bounds;
+        shape = `Text_lines { lines; font_size; line_height; caret };
+        style = RenderStyle.Fill text_color;
+        decorative;
+      }
 
+  (* Appends the primitives of the subtree to [buffer]. A subtree carried
+     over from last frame, in the same box, draws the same and is copied from
+     [last], the buffer filled last frame, as one range. *)
+  let rec apply_layout_to_ui_node (buffer : primitive_buffer)
+      ~(last : primitive_buffer) ?(offset_x = 0.0) ?(offset_y = 0.0)
+      ?(decorative = false) (retained : 'msg retained) =
+    let layout_bounds = get_layout_info retained.flex in
+
+    (* Get style and apply transform *)
+    let style = node_style retained.ui in
+
+    let decorative = decorative || style.decorative = Some true in
     let transform_x, transform_y = get_transform_offset style.transform in
     let abs_x = offset_x +. layout_bounds.x +. transform_x in
     let abs_y = offset_y +. layout_bounds.y +. transform_y in
-    match ui_node with
+    let start = buffer.count in
+    let placed = retained.placed_box in
+    if
+      (not retained.live)
+      && retained.primitives_frame = last.frame
+      && retained.placed_decorative = decorative
+      && placed.x = abs_x
+      && placed.y = abs_y
+      && placed.width = layout_bounds.width
+      && placed.height = layout_bounds.height
+    then
+      Primitive_buffer.append buffer last ~start:retained.primitives_start
+        ~length:retained.primitives_length
+    else begin
+      node_primitives buffer ~last ~decorative ~abs_x ~abs_y ~transform_x
+        ~transform_y ~layout_bounds retained;
+      retained.placed_box <-
+        {
+          x = abs_x;
+          y = abs_y;
+          width = layout_bounds.width;
+          height = layout_bounds.height;
+        };
+      retained.placed_decorative <- decorative;
+      retained.primitives_length <- buffer.count - start
+    end;
+    retained.primitives_frame <- buffer.frame;
+    retained.primitives_start <- start
+
+  and node_primitives buffer ~last ~decorative ~abs_x ~abs_y ~transform_x
+      ~transform_y ~(layout_bounds : bounds) (retained : 'msg retained) =
+    let bounds =
+      {
+        x = abs_x;
+        y = abs_y;
+        width = layout_bounds.width;
+        height = layout_bounds.height;
+      }
+    in
+    match retained.ui with
     | Empty ->
-        []
+        ()
+    | Static static ->
+        (* The cached layout applies the transform itself *)
+        static_primitives buffer static ~decorative ~x:(abs_x -. transform_x)
+          ~y:(abs_y -. transform_y) ~width:layout_bounds.width
+          ~height:layout_bounds.height
     | Text { content; style; _ } ->
-        let font_size = Option.value style.font_size ~default:12.0 in
-        let text_color =
-          Option.value style.text_color ~default:(Color.make ~r:0 ~g:0 ~b:0 ())
-        in
-        [
-          {
-            bounds =
-              {
-                x = abs_x;
-                y = abs_y;
-                width = layout_bounds.width;
-                height = layout_bounds.height;
-              };
-            shape = `Rectangle;
-            style =
-              RenderStyle.Text
-                ( text_color,
-                  content,
-                  int_of_float abs_x,
-                  int_of_float abs_y,
-                  font_size );
-          };
-        ]
+        push_text buffer ~decorative ~bounds content style
     | Canvas { primitives; style; _ } ->
-        let background =
-          match style.background_color with
-          | None ->
-              []
-          | Some bg_color ->
-              let bg_style =
-                match (style.border_color, style.border_width) with
-                | Some border_color, Some border_width ->
-                    RenderStyle.FillAndStroke
-                      (bg_color, border_color, border_width)
-                | _ ->
-                    RenderStyle.Fill bg_color
-              in
-              [
-                {
-                  bounds =
-                    {
-                      x = abs_x;
-                      y = abs_y;
-                      width = layout_bounds.width;
-                      height = layout_bounds.height;
-                    };
-                  shape =
-                    (match style.border_radius with
-                    | Some radius ->
-                        `RoundedRectangle radius
-                    | None ->
-                        `Rectangle);
-                  style = bg_style;
-                };
-              ]
-        in
-        let converted_primitives =
-          primitives
-          |> List.map (fun primitive ->
-                 match primitive with
-                 | Rectangle { x; y; width; height; style } ->
-                     let render_style =
-                       match style with
-                       | Fill color ->
-                           RenderStyle.Fill color
-                       | Stroke (color, w) ->
-                           RenderStyle.Stroke (color, w)
-                       | FillAndStroke (fill, stroke, w) ->
-                           RenderStyle.FillAndStroke (fill, stroke, w)
-                     in
-                     {
-                       bounds =
-                         { x = x +. abs_x; y = y +. abs_y; width; height };
-                       shape = `Rectangle;
-                       style = render_style;
-                     }
-                 | Ellipse { cx; cy; rx; ry; style } ->
-                     let render_style =
-                       match style with
-                       | Fill color ->
-                           RenderStyle.Fill color
-                       | Stroke (color, w) ->
-                           RenderStyle.Stroke (color, w)
-                       | FillAndStroke (fill, stroke, w) ->
-                           RenderStyle.FillAndStroke (fill, stroke, w)
-                     in
-                     let bounds_x = cx -. rx +. abs_x in
-                     let bounds_y = cy -. ry +. abs_y in
-                     let bounds_width = rx *. 2.0 in
-                     let bounds_height = ry *. 2.0 in
-                     {
-                       bounds =
-                         {
-                           x = bounds_x;
-                           y = bounds_y;
-                           width = bounds_width;
-                           height = bounds_height;
-                         };
-                       shape = `Ellipse;
-                       style = render_style;
-                     }
-                 | Path { points; style } ->
-                     let render_style =
-                       match style with
-                       | Fill color ->
-                           RenderStyle.Fill color
-                       | Stroke (color, w) ->
-                           RenderStyle.Stroke (color, w)
-                       | FillAndStroke (fill, stroke, w) ->
-                           RenderStyle.FillAndStroke (fill, stroke, w)
-                     in
-                     let offset_points =
-                       List.map
-                         (fun (px, py) -> (px +. abs_x, py +. abs_y))
-                         points
-                     in
-                     let bounds =
-                       match offset_points with
-                       | [] ->
-                           { x = abs_x; y = abs_y; width = 0.0; height = 0.0 }
-                       | _ ->
-                           let xs = List.map fst offset_points in
-                           let ys = List.map snd offset_points in
-                           let min_x = List.fold_left min (List.hd xs) xs in
-                           let max_x = List.fold_left max (List.hd xs) xs in
-                           let min_y = List.fold_left min (List.hd ys) ys in
-                           let max_y = List.fold_left max (List.hd ys) ys in
-                           {
-                             x = min_x;
-                             y = min_y;
-                             width = max_x -. min_x;
-                             height = max_y -. min_y;
-                           }
-                     in
-                     {
-                       bounds;
-                       shape = `Path offset_points;
-                       style = render_style;
-                     })
-        in
-        background @ converted_primitives
+        push_canvas buffer ~decorative ~bounds primitives style
+    | Chart { series; style; color; line_width; y_range; _ } ->
+        push_chart buffer ~decorative ~bounds series style ~color ~line_width
+          ~y_range
+    | Raster { raster; style; _ } ->
+        push_raster buffer ~decorative ~bounds raster style
+    | Editor { editor; style; _ } ->
+        push_editor buffer ~decorative ~bounds editor style
     | View { style; children; _ } ->
-        let background =
-          match style.background_color with
-          | None ->
-              []
-          | Some bg_color ->
-              let bg_style =
-                match (style.border_color, style.border_width) with
-                | Some border_color, Some border_width ->
-                    RenderStyle.FillAndStroke
-                      (bg_color, border_color, border_width)
-                | _ ->
-                    RenderStyle.Fill bg_color
-              in
-              [
-                {
-                  bounds =
-                    {
-                      x = abs_x;
-                      y = abs_y;
-                      width = layout_bounds.width;
-                      height = layout_bounds.height;
-                    };
-                  shape =
-                    (match style.border_radius with
-                    | Some radius ->
-                        `RoundedRectangle radius
-                    | None ->
-                        `Rectangle);
-                  style = bg_style;
-                };
-              ]
-        in
-        let relative_children =
-          List.filter
-            (fun child -> not (is_absolutely_positioned child))
-            children
-        in
-        let absolute_children = List.filter is_absolutely_positioned children in
-
+        push_background buffer ~decorative style bounds;
         (* Render relative children using flex layout *)
-        let relative_primitives =
-          List.mapi
-            (fun i child ->
-              if i < Array.length flex_node.children then
-                apply_layout_to_ui_node ~offset_x:abs_x ~offset_y:abs_y
-                  flex_node.children.(i) child
-              else
-                [])
-            relative_children
-          |> List.concat
-        in
+        Array.iter
+          (apply_layout_to_ui_node buffer ~last ~offset_x:abs_x
+             ~offset_y:abs_y ~decorative)
+          retained.children;
 
         (* Render absolute children positioned at parent origin *)
-        let absolute_primitives =
-          List.concat_map
-            (fun child ->
-              let child_style =
-                match child with
-                | View { style; _ } ->
-                    style
-                | Text { style; _ } ->
-                    style
-                | Canvas { style; _ } ->
-                    style
-                | Empty ->
-                    Style.default
-              in
-              let transform_x, transform_y =
-                get_transform_offset child_style.transform
-              in
-              apply_layout_to_ui_node_absolute ~offset_x:(abs_x +. transform_x)
-                ~offset_y:(abs_y +. transform_y) child child_style)
-            absolute_children
-        in
-
-        background @ relative_primitives @ absolute_primitives
-
-  and apply_layout_to_ui_node_absolute ~offset_x ~offset_y
-      (ui_node : 'msg interactive_node) (style : Style.t) :
-      render_primitive list =
+        Array.iter
+          (fun child ->
+            let child_style = node_style child in
+            let transform_x, transform_y =
+              get_transform_offset child_style.transform
+            in
+            apply_layout_to_ui_node_absolute buffer
+              ~offset_x:(abs_x +. transform_x) ~offset_y:(abs_y +. transform_y)
+              ~decorative child child_style)
+          (absolute_children children)
+
+  and apply_layout_to_ui_node_absolute buffer ~offset_x ~offset_y ~decorative
+      (ui_node : 'msg interactive_node) (style : Style.t) =
     (* For absolutely positioned elements, render without flex layout *)
+    let decorative = decorative || style.decorative = Some true in
     let width = Option.value style.width ~default:0 in
     let height = Option.value style.height ~default:0 in
     let bounds =
@@ -470,337 +733,232 @@ module FlexIntegrationImpl = struct
 
     match ui_node with
     | Empty ->
-        []
+        ()
+    | Static static ->
+        let transform_x, transform_y = get_transform_offset style.transform in
+        static_primitives buffer static ~decorative ~x:(offset_x -. transform_x)
+          ~y:(offset_y -. transform_y) ~width:bounds.width ~height:bounds.height
     | Text { content; style; _ } ->
-        let font_size = Option.value style.font_size ~default:12.0 in
-        let text_color =
-          Option.value style.text_color ~default:(Color.make ~r:0 ~g:0 ~b:0 ())
-        in
-        [
-          {
-            bounds;
-            shape = `Rectangle;
-            style =
-              RenderStyle.Text
-                ( text_color,
-                  content,
-                  int_of_float offset_x,
-                  int_of_float offset_y,
-                  font_size );
-          };
-        ]
+        push_text buffer ~decorative ~bounds content style
     | Canvas { primitives; style; _ } ->
-        let background =
-          match style.background_color with
-          | None ->
-              []
-          | Some bg_color ->
-              let bg_style =
-                match (style.border_color, style.border_width) with
-                | Some border_color, Some border_width ->
-                    RenderStyle.FillAndStroke
-                      (bg_color, border_color, border_width)
-                | _ ->
-                    RenderStyle.Fill bg_color
-              in
-              [
-                {
-                  bounds;
-                  shape =
-                    (match style.border_radius with
-                    | Some radius ->
-                        `RoundedRectangle radius
-                    | None ->
-                        `Rectangle);
-                  style = bg_style;
-                };
-              ]
-        in
-        let converted_primitives =
-          primitives
-          |> List.map (fun primitive ->
-                 match primitive with
-                 | Rectangle { x; y; width; height; style } ->
-                     let render_style =
-                       match style with
-                       | Fill color ->
-                           RenderStyle.Fill color
-                       | Stroke (color, w) ->
-                           RenderStyle.Stroke (color, w)
-                       | FillAndStroke (fill, stroke, w) ->
-                           RenderStyle.FillAndStroke (fill, stroke, w)
-                     in
-                     {
-                       bounds =
-                         { x = offset_x +. x; y = offset_y +. y; width; height };
-                       shape = `Rectangle;
-                       style = render_style;
-                     }
-                 | Ellipse { cx; cy; rx; ry; style } ->
-                     let render_style =
-                       match style with
-                       | Fill color ->
-                           RenderStyle.Fill color
-                       | Stroke (color, w) ->
-                           RenderStyle.Stroke (color, w)
-                       | FillAndStroke (fill, stroke, w) ->
-                           RenderStyle.FillAndStroke (fill, stroke, w)
-                     in
-                     {
-                       bounds =
-                         {
-                           x = offset_x +. cx -. rx;
-                           y = offset_y +. cy -. ry;
-                           width = rx *. 2.0;
-                           height = ry *. 2.0;
-                         };
-                       shape = `Ellipse;
-                       style = render_style;
-                     }
-                 | Path { points; style } ->
-                     let render_style =
-                       match style with
-                       | Fill color ->
-                           RenderStyle.Fill color
-                       | Stroke (color, w) ->
-                           RenderStyle.Stroke (color, w)
-                       | FillAndStroke (fill, stroke, w) ->
-                           RenderStyle.FillAndStroke (fill, stroke, w)
-                     in
-                     let offset_points =
-                       List.map
-                         (fun (px, py) -> (px +. offset_x, py +. offset_y))
-                         points
-                     in
-                     let bounds =
-                       match offset_points with
-                       | [] ->
-                           {
-                             x = offset_x;
-                             y = offset_y;
-                             width = 0.0;
-                             height = 0.0;
-                           }
-                       | _ ->
-                           let xs = List.map fst offset_points in
-                           let ys = List.map snd offset_points in
-                           let min_x = List.fold_left min (List.hd xs) xs in
-                           let max_x = List.fold_left max (List.hd xs) xs in
-                           let min_y = List.fold_left min (List.hd ys) ys in
-                           let max_y = List.fold_left max (List.hd ys) ys in
-                           {
-                             x = min_x;
-                             y = min_y;
-                             width = max_x -. min_x;
-                             height = max_y -. min_y;
-                           }
-                     in
-                     {
-                       bounds;
-                       shape = `Path offset_points;
-                       style = render_style;
-                     })
-        in
-        background @ converted_primitives
+        push_canvas buffer ~decorative ~bounds primitives style
+    | Chart { series; style; color; line_width; y_range; _ } ->
+        push_chart buffer ~decorative ~bounds series style ~color ~line_width
+          ~y_range
+    | Raster { raster; style; _ } ->
+        push_raster buffer ~decorative ~bounds raster style
+    | Editor { editor; style; _ } ->
+        push_editor buffer ~decorative ~bounds editor style
     | View { style; children; _ } ->
-        let background =
-          match style.background_color with
-          | None ->
-              []
-          | Some bg_color ->
-              let bg_style =
-                match (style.border_color, style.border_width) with
-                | Some border_color, Some border_width ->
-                    RenderStyle.FillAndStroke
-                      (bg_color, border_color, border_width)
-                | _ ->
-                    RenderStyle.Fill bg_color
-              in
-              [
-                {
-                  bounds;
-                  shape =
-                    (match style.border_radius with
-                    | Some radius ->
-                        `RoundedRectangle radius
-                    | None ->
-                        `Rectangle);
-                  style = bg_style;
-                };
-              ]
-        in
-        let child_primitives =
-          List.concat_map
-            (fun child ->
-              let child_style =
-                match child with
-                | View { style; _ } ->
-                    style
-                | Text { style; _ } ->
-                    style
-                | Canvas { style; _ } ->
-                    style
-                | Empty ->
-                    Style.default
-              in
-              let transform_x, transform_y =
-                get_transform_offset child_style.transform
-              in
-              apply_layout_to_ui_node_absolute
-                ~offset_x:(offset_x +. transform_x)
-                ~offset_y:(offset_y +. transform_y) child child_style)
-            children
-        in
-        background @ child_primitives
-
-  let layout_ui_tree ?(width = 800) ?(height = 600)
-      (ui_root : 'msg interactive_node) : render_primitive list =
-    let flex_root = create_flex_node ui_root in
-    FlexLayoutEngine.layoutNode flex_root width height FlexTypes.Ltr;
-    apply_layout_to_ui_node flex_root ui_root
-
-  let rec build_node_with_bounds ?(offset_x = 0.0) ?(offset_y = 0.0)
-      ?(path = []) (flex_node : FlexTypes.node)
-      (ui_node : 'msg interactive_node) : 'msg node_with_bounds =
-    let layout_bounds = get_layout_info flex_node in
+        push_background buffer ~decorative style bounds;
+        Array.iter
+          (fun child ->
+            let child_style = node_style child in
+            let transform_x, transform_y =
+              get_transform_offset child_style.transform
+            in
+            apply_layout_to_ui_node_absolute buffer
+              ~offset_x:(offset_x +. transform_x)
+              ~offset_y:(offset_y +. transform_y) ~decorative child child_style)
+          children
+
+  (* Lays out static content at the origin, once per size *)
+  and static_layout static ~width ~height =
+    match static.laid_out with
+    | Some laid_out when laid_out.size = (width, height) ->
+        laid_out
+    | _ ->
+        let root = retain ~pass:(ref ()) (static_content static) in
+        layout_flex root.flex ~width:(int_of_float width)
+          ~height:(int_of_float height);
+        let tree = Bounds_tree.create () in
+        place_bounds tree ~last:tree ~parent:Bounds_tree.none
+          ~after:Bounds_tree.none ~index:0 ~offset_x:0.0 ~offset_y:0.0 root
+        |> ignore;
+        let primitives = Primitive_buffer.create () in
+        apply_layout_to_ui_node primitives ~last:primitives root;
+        let laid_out = { size = (width, height); tree; primitives } in
+        static.laid_out <- Some laid_out;
+        static.placed_primitives <- None;
+        laid_out
+
+  and static_primitives buffer static ~decorative ~x ~y ~width ~height =
+    let laid_out = static_layout static ~width ~height in
+    let placed =
+      match static.placed_primitives with
+      | Some (placed_x, placed_y, placed) when placed_x = x && placed_y = y ->
+          placed
+      | previous ->
+          let placed =
+            match previous with
+            | Some (_, _, placed) ->
+                Primitive_buffer.clear placed;
+                placed
+            | None ->
+                Primitive_buffer.create ()
+          in
+          Primitive_buffer.iter
+            (fun primitive ->
+              Primitive_buffer.push placed
+                (translate_primitive ~dx:x ~dy:y primitive))
+            laid_out.primitives;
+          static.placed_primitives <- Some (x, y, placed);
+          placed
+    in
+    if decorative then
+      Primitive_buffer.iter
+        (fun primitive ->
+          Primitive_buffer.push buffer { primitive with decorative })
+        placed
+    else
+      Primitive_buffer.append buffer placed ~start:0 ~length:placed.count
+
+  (* Appends the node's entry and its subtree to [tree] and returns the
+     entry. A subtree carried over from last frame at the same size is copied
+     from [last], the tree filled last frame, as one range. *)
+  and place_bounds (tree : 'msg bounds_tree) ~(last : 'msg bounds_tree) ~parent
+      ~after ~index ~offset_x ~offset_y (retained : 'msg retained) : int =
+    let layout_bounds = get_layout_info retained.flex in
     let abs_x = offset_x +. layout_bounds.x in
     let abs_y = offset_y +. layout_bounds.y in
 
     (* Apply transform if present *)
-    let style =
-      match ui_node with
-      | View { style; _ } ->
-          style
-      | Text { style; _ } ->
-          style
-      | Canvas { style; _ } ->
-          style
-      | Empty ->
-          Style.default
-    in
-
-    let transform_x, transform_y =
-      match style.transform with
-      | Some (Translate { x; y }) ->
-          (x, y)
-      | Some (TranslateX x) ->
-          (x, 0.0)
-      | Some (TranslateY y) ->
-          (0.0, y)
-      | Some (Compose transforms) ->
-          (* For now, just accumulate translations from composed transforms *)
-          List.fold_left
-            (fun (acc_x, acc_y) t ->
-              match t with
-              | Translate { x; y } ->
-                  (acc_x +. x, acc_y +. y)
-              | TranslateX x ->
-                  (acc_x +. x, acc_y)
-              | TranslateY y ->
-                  (acc_x, acc_y +. y)
-              | _ ->
-                  (acc_x, acc_y))
-            (0.0, 0.0) transforms
-      | _ ->
-          (0.0, 0.0)
-    in
+    let style = node_style retained.ui in
+    let transform_x, transform_y = get_transform_offset style.transform in
+    let x = abs_x +. transform_x in
+    let y = abs_y +. transform_y in
+    let start = retained.span_start in
+    if
+      retained.span_generation = last.generation
+      && Float.Array.get last.widths start = layout_bounds.width
+      && Float.Array.get last.heights start = layout_bounds.height
+    then begin
+      let entry =
+        Bounds_tree.copy tree ~parent ~after ~index
+          ~dx:(x -. Float.Array.get last.xs start)
+          ~dy:(y -. Float.Array.get last.ys start)
+          last ~start ~length:retained.span_length
+      in
+      retained.span_generation <- tree.generation;
+      retained.span_start <- entry;
+      entry
+    end
+    else begin
+      let entry =
+        Bounds_tree.add tree ~parent ~after ~index retained.ui ~x ~y
+          ~width:layout_bounds.width ~height:layout_bounds.height
+      in
+      place_children tree ~last ~entry ~abs_x ~abs_y ~layout_bounds retained;
+      retained.span_generation <- tree.generation;
+      retained.span_start <- entry;
+      retained.span_length <- tree.length - entry;
+      entry
+    end
+
+  and place_children tree ~last ~entry ~abs_x ~abs_y ~(layout_bounds : bounds)
+      (retained : 'msg retained) =
+    match retained.ui with
+    | View { children = ui_children; _ } ->
+        (* Process relative children using flex layout *)
+        let after = ref Bounds_tree.none in
+        Array.iteri
+          (fun i child ->
+            after :=
+              place_bounds tree ~last ~parent:entry ~after:!after ~index:i
+                ~offset_x:abs_x ~offset_y:abs_y child)
+          retained.children;
+
+        (* Process absolute children - position at parent origin (0,0) *)
+        let relative_count = Array.length retained.children in
+        Array.iteri
+          (fun i child ->
+            let child_style = node_style child in
+            let width = Option.value child_style.width ~default:0 in
+            let height = Option.value child_style.height ~default:0 in
+            let transform_x, transform_y =
+              get_transform_offset child_style.transform
+            in
+            after :=
+              Bounds_tree.add tree ~parent:entry ~after:!after
+                ~index:(relative_count + i) child ~x:(abs_x +. transform_x)
+                ~y:(abs_y +. transform_y) ~width:(float_of_int width)
+                ~height:(float_of_int height))
+          (absolute_children ui_children)
+    | Static static ->
+        let laid_out =
+          static_layout static ~width:layout_bounds.width
+            ~height:layout_bounds.height
+        in
+        Bounds_tree.copy tree ~parent:entry ~after:Bounds_tree.none ~index:0
+          ~dx:abs_x ~dy:abs_y laid_out.tree ~start:0
+          ~length:laid_out.tree.length
+        |> ignore
+    | _ ->
+        ()
 
-    let bounds =
-      {
-        x = abs_x +. transform_x;
-        y = abs_y +. transform_y;
-        width = layout_bounds.width;
-        height = layout_bounds.height;
-      }
-    in
-    let children =
-      match ui_node with
-      | View { children = ui_children; _ } ->
-          let relative_children =
-            List.filter
-              (fun child -> not (is_absolutely_positioned child))
-              ui_children
-          in
-          let absolute_children =
-            List.filter is_absolutely_positioned ui_children
-          in
+  let layout_ui_tree ?(width = 800) ?(height = 600)
+      (ui_root : 'msg interactive_node) : render_primitive list =
+    let root = retain ~pass:(ref ()) ui_root in
+    layout_flex root.flex ~width ~height;
+    let primitives = Primitive_buffer.create () in
+    apply_layout_to_ui_node primitives ~last:primitives root;
+    Primitive_buffer.to_list primitives
+end
 
-          (* Process relative children using flex layout *)
-          (* let () = Printf.eprintf "relative_children count: %d, flex_node.children count: %d\n%!"
-            (List.length relative_children) (Array.length flex_node.children) in *)
-          let relative_bounds =
-            List.mapi
-              (fun i child ->
-                if i < Array.length flex_node.children then
-                  build_node_with_bounds ~offset_x:abs_x ~offset_y:abs_y
-                    ~path:(path @ [ i ]) flex_node.children.(i) child
-                else
-                  let () =
-                    Printf.eprintf "WARNING: child %d out of bounds!\n%!" i
-                  in
-                  {
-                    node = child;
-                    bounds = { x = 0.0; y = 0.0; width = 0.0; height = 0.0 };
-                    children = [];
-                    path = path @ [ i ];
-                  })
-              relative_children
-          in
+type 'msg retained = 'msg FlexIntegrationImpl.retained
 
-          (* Process absolute children - position at parent origin (0,0) *)
-          let absolute_bounds =
-            List.mapi
-              (fun i child ->
-                let child_style =
-                  match child with
-                  | View { style; _ } ->
-                      style
-                  | Text { style; _ } ->
-                      style
-                  | Canvas { style; _ } ->
-                      style
-                  | Empty ->
-                      Style.default
-                in
-                let width = Option.value child_style.width ~default:0 in
-                let height = Option.value child_style.height ~default:0 in
-                let transform_x, transform_y =
-                  get_transform_offset child_style.transform
-                in
-                {
-                  node = child;
-                  bounds =
-                    {
-                      x = abs_x +. transform_x;
-                      y = abs_y +. transform_y;
-                      width = float_of_int width;
-                      height = float_of_int height;
-                    };
-                  children = [];
-                  path = path @ [ List.length relative_children + i ];
-                })
-              absolute_children
-          in
+let layout_node_impl ~x:_ ~y:_ node = FlexIntegrationImpl.layout_ui_tree node
 
-          relative_bounds @ absolute_bounds
+(* Lays out [node] into [tree] and [primitives]. [previous] is the retained
+   root from the last call for the same window, and [last_tree] and
+   [last_primitives] what that call filled; what they hold for physically
+   equal subtrees is reused. *)
+let layout_retained ?previous ~tree ~last_tree ~primitives ~last_primitives
+    ?(width = 800) ?(height = 600) node =
+  Bounds_tree.clear tree;
+  Primitive_buffer.clear primitives;
+  let root = FlexIntegrationImpl.retain ?previous ~pass:(ref ()) node in
+  FlexIntegrationImpl.layout_flex root.flex ~width ~height;
+  FlexIntegrationImpl.place_bounds tree ~last:last_tree ~parent:Bounds_tree.none
+    ~after:Bounds_tree.none ~index:0 ~offset_x:0.0 ~offset_y:0.0 root
+  |> ignore;
+  FlexIntegrationImpl.apply_layout_to_ui_node primitives ~last:last_primitives
+    root;
+  root
+
+let rec inside_static tree entry =
+  let parent = (tree : 'msg bounds_tree).parents.(entry) in
+  parent <> Bounds_tree.none
+  &&
+  match Bounds_tree.node tree parent with
+  | Static _ ->
+      true
+  | _ ->
+      inside_static tree parent
+
+(* Content [tree] shows that can change while its node stays the same:
+   series of charts and buffers of editors, which are drawn again on every
+   render except inside a static, and rasters, which upload their changes
+   whenever they are drawn. Returns whether any of it changed since. *)
+let changed_since (tree : 'msg bounds_tree) =
+  let checks = ref [] in
+  for entry = 0 to tree.length - 1 do
+    let check =
+      match Bounds_tree.node tree entry with
+      | Chart { series; _ } when not (inside_static tree entry) ->
+          let version = Series.version series in
+          Some (fun () -> Series.version series <> version)
+      | Editor { editor; _ } when not (inside_static tree entry) ->
+          let buffer = Text_editor.buffer editor in
+          let version = Text_buffer.version buffer in
+          Some (fun () -> Text_buffer.version buffer <> version)
+      | Raster { raster; _ } ->
+          let version = Raster.version raster in
+          Some (fun () -> Raster.version raster <> version)
       | _ ->
-          []
+          None
     in
-    { node = ui_node; bounds; children; path }
-end
-
-let layout_node_impl ~x:_ ~y:_ node = FlexIntegrationImpl.layout_ui_tree node
-
-let layout_with_bounds ?(width = 800) ?(height = 600) node =
-  let flex_root = FlexIntegrationImpl.create_flex_node node in
-  FlexIntegrationImpl.FlexLayoutEngine.layoutNode flex_root width height
-    FlexIntegrationImpl.FlexTypes.Ltr;
-  FlexIntegrationImpl.build_node_with_bounds flex_root node
-
-let layout_with_bounds_and_primitives ?(width = 800) ?(height = 600) node =
-  let flex_root = FlexIntegrationImpl.create_flex_node node in
-  FlexIntegrationImpl.FlexLayoutEngine.layoutNode flex_root width height
-    FlexIntegrationImpl.FlexTypes.Ltr;
-  let bounds_tree = FlexIntegrationImpl.build_node_with_bounds flex_root node in
-  let primitives = FlexIntegrationImpl.apply_layout_to_ui_node flex_root node in
-  (bounds_tree, primitives)
+    Option.iter (fun check -> checks := check :: !checks) check
+  done;
+  let checks = !checks in
+  fun () -> List.exists (fun changed -> changed ()) checks
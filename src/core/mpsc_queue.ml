@@ -0,0 +1,86 @@
+(* Bounded lock-free multi-producer single-consumer queue (a ring of cells
+   with sequence numbers, after Vyukov). Any domain or thread may push; only
+   the event loop pops. Popping an empty queue does not allocate.
+
+   A cell at ring position [pos] is free for the producer claiming [pos] when
+   its sequence equals [pos], and holds a value for the consumer when its
+   sequence equals [pos + 1]. The consumer hands the cell to the next lap by
+   setting it to [pos + capacity]. *)
+
+type 'a cell = { sequence : int Atomic.t; mutable value : 'a option }
+
+type 'a t = {
+  cells : 'a cell array;
+  mask : int;
+  tail : int Atomic.t;
+  mutable head : int;
+}
+
+let create ~capacity =
+  let rec power_of_two n = if n >= capacity then n else power_of_two (n * 2) in
+  let size = power_of_two 2 in
+  {
+    cells =
+      Array.init size (fun i -> { sequence = Atomic.make i; value = None });
+    mask = size - 1;
+    tail = Atomic.make 0;
+    head = 0;
+  }
+
+let capacity t = t.mask + 1
+
+(* [false] when the queue is full *)
+let push t value =
+  let rec attempt () =
+    let pos = Atomic.get t.tail in
+    let cell = t.cells.(pos land t.mask) in
+    let sequence = Atomic.get cell.sequence in
+    if sequence = pos then
+      if Atomic.compare_and_set t.tail pos (pos + 1) then begin
+        cell.value <- Some value;
+        (* Publishes the value to the consumer *)
+        Atomic.set cell.sequence (pos + 1);
+        true
+      end
+      else
+        attempt ()
+    else if sequence < pos then
+      false
+    else
+      (* Another producer claimed [pos] first *)
+      attempt ()
+  in
+  attempt ()
+
+(* Consumer only *)
+let pop t =
+  let cell = t.cells.(t.head land t.mask) in
+  if Atomic.get cell.sequence = t.head + 1 then begin
+    let value = cell.value in
+    cell.value <- None;
+    Atomic.set cell.sequence (t.head + t.mask + 1);
+    t.head <- t.head + 1;
+    value
+  end
+  else
+    None
+
+(* Consumer only *)
+let is_empty t =
+  Atomic.get t.cells.(t.head land t.mask).sequence <> t.head + 1
+
+(* Consumer only. Applies [f] to at most [limit] values in push order and
+   returns how many were taken. *)
+let drain t ~limit f =
+  let rec go taken =
+    if taken >= limit then
+      taken
+    else
+      match pop t with
+      | Some value ->
+          f value;
+          go (taken + 1)
+      | None ->
+          taken
+  in
+  go 0
@@ -0,0 +1,56 @@
+(* Operations on primitive buffers (see Types.primitive_buffer). A window
+   keeps two buffers and alternates between them, so the previous frame's
+   primitives stay readable while the next frame is laid out and unchanged
+   subtrees can be copied over as a range. *)
+
+open Types
+
+(* Frames are unique across all buffers, so a recorded (frame, start) pair
+   can only ever refer to one buffer's contents *)
+let next_frame = Atomic.make 0
+
+let fresh_frame () = Atomic.fetch_and_add next_frame 1
+
+(* Fills unused slots, so cleared primitives are not kept alive *)
+let unused =
+  {
+    bounds = { x = 0.0; y = 0.0; width = 0.0; height = 0.0 };
+    shape = `Rectangle;
+    style = RenderStyle.Fill (Color.make ~r:0 ~g:0 ~b:0 ());
+    decorative = false;
+  }
+
+let create () = { count = 0; frame = fresh_frame (); items = [||] }
+
+let clear (buffer : primitive_buffer) =
+  Array.fill buffer.items 0 buffer.count unused;
+  buffer.count <- 0;
+  buffer.frame <- fresh_frame ()
+
+let reserve (buffer : primitive_buffer) needed =
+  let capacity = Array.length buffer.items in
+  if needed > capacity then begin
+    let items = Array.make (max needed (max 256 (capacity * 2))) unused in
+    Array.blit buffer.items 0 items 0 buffer.count;
+    buffer.items <- items
+  end
+
+let push (buffer : primitive_buffer) primitive =
+  reserve buffer (buffer.count + 1);
+  buffer.items.(buffer.count) <- primitive;
+  buffer.count <- buffer.count + 1
+
+(* Appends [length] primitives of [source] from [start] *)
+let append (buffer : primitive_buffer) (source : primitive_buffer) ~start
+    ~length =
+  reserve buffer (buffer.count + length);
+  Array.blit source.items start buffer.items buffer.count length;
+  buffer.count <- buffer.count + length
+
+let iter f (buffer : primitive_buffer) =
+  for i = 0 to buffer.count - 1 do
+    f buffer.items.(i)
+  done
+
+let to_list (buffer : primitive_buffer) =
+  List.init buffer.count (fun i -> buffer.items.(i))
@@ -0,0 +1,94 @@
+open Tgles2
+
+(* Offscreen colour + stencil target. The scene is rendered into it at a
+   reduced resolution and then upscaled to the window in a single quad. GL
+   objects are created on first use and recreated when the size changes. *)
+
+type t = {
+  mutable framebuffer : int;
+  mutable texture : int;
+  mutable stencil : int;
+  mutable width : int;
+  mutable height : int;
+  mutable unsupported : bool;
+}
+
+let create () =
+  {
+    framebuffer = 0;
+    texture = 0;
+    stencil = 0;
+    width = 0;
+    height = 0;
+    unsupported = false;
+  }
+
+let release t =
+  if t.framebuffer <> 0 then begin
+    Gl_quad.set_int (Gl.delete_framebuffers 1) t.framebuffer;
+    Gl_quad.set_int (Gl.delete_renderbuffers 1) t.stencil;
+    Gl_quad.delete_texture t.texture;
+    t.framebuffer <- 0;
+    t.stencil <- 0;
+    t.texture <- 0;
+    t.width <- 0;
+    t.height <- 0
+  end
+
+let allocate t ~width ~height =
+  release t;
+  let texture = Gl_quad.create_texture ~filter:Gl.linear in
+  Gl.tex_image2d Gl.texture_2d 0 Gl.rgba width height 0 Gl.rgba
+    Gl.unsigned_byte (`Offset 0);
+  (* Wall fills concave paths through the stencil buffer *)
+  let stencil = Gl_quad.get_int (Gl.gen_renderbuffers 1) in
+  Gl.bind_renderbuffer Gl.renderbuffer stencil;
+  Gl.renderbuffer_storage Gl.renderbuffer Gl.stencil_index8 width height;
+  let framebuffer = Gl_quad.get_int (Gl.gen_framebuffers 1) in
+  Gl.bind_framebuffer Gl.framebuffer framebuffer;
+  Gl.framebuffer_texture2d Gl.framebuffer Gl.color_attachment0 Gl.texture_2d
+    texture 0;
+  Gl.framebuffer_renderbuffer Gl.framebuffer Gl.stencil_attachment
+    Gl.renderbuffer stencil;
+  let complete =
+    Gl.check_framebuffer_status Gl.framebuffer = Gl.framebuffer_complete
+  in
+  Gl.bind_framebuffer Gl.framebuffer 0;
+  t.framebuffer <- framebuffer;
+  t.texture <- texture;
+  t.stencil <- stencil;
+  t.width <- width;
+  t.height <- height;
+  if not complete then begin
+    Printf.eprintf
+      "Warning: offscreen rendering unavailable, using full resolution\n%!";
+    release t;
+    t.unsupported <- true
+  end
+
+(* Makes the target current at [width] x [height]. Returns [false] when
+   offscreen rendering is not available, in which case callers render
+   directly to the window. *)
+let bind t ~width ~height =
+  if
+    (not t.unsupported)
+    && (t.framebuffer = 0 || t.width <> width || t.height <> height)
+  then allocate t ~width ~height;
+  if t.unsupported then
+    false
+  else begin
+    Gl.bind_framebuffer Gl.framebuffer t.framebuffer;
+    Gl.viewport 0 0 width height;
+    Gl.clear_stencil 0;
+    Gl.clear Gl.stencil_buffer_bit;
+    true
+  end
+
+(* Upscales the target over the whole window of [width] x [height] pixels *)
+let present t ~width ~height =
+  Gl.bind_framebuffer Gl.framebuffer 0;
+  Gl.viewport 0 0 width height;
+  let width = float_of_int width and height = float_of_int height in
+  (* GL textures start at the bottom row, so the quad's top samples v = 1 *)
+  Gl_quad.draw ~texture:t.texture ~viewport_width:width ~viewport_height:height
+    ~x:0.0 ~y:0.0 ~w:width ~h:height ~uv:(0.0, 1.0, 1.0, 0.0) ~blend:false
@@ -23,15 +23,75 @@ module Renderer = struct
          Printf.eprintf "Warning: Could not load font file\n";
          None)
 
+  (* Wall renderers are shared by every window. The non-antialiased one is
+     only created once the quality governor first asks for it. *)
+  type wall_renderers = {
+    antialiased : Wall.Renderer.t;
+    mutable aliased : Wall.Renderer.t option;
+  }
+
+  (* [width] and [height] are in window coordinates, which is what layout
+     uses. [scale] is the drawable-to-window ratio (2.0 on most HiDPI
+     displays). *)
   type state = {
-    wall_renderer : Wall.Renderer.t;
+    wall_renderers : wall_renderers;
     width : float;
     height : float;
+    scale : float;
+    quality : Quality.settings;
+    dynamic_scale : float;
+    offscreen : Render_target.t;
   }
 
   let create ~width ~height =
-    let wall_renderer = Wall.Renderer.create ~antialias:true () in
-    { wall_renderer; width = float_of_int width; height = float_of_int height }
+    let antialiased = Wall.Renderer.create ~antialias:true () in
+    {
+      wall_renderers = { antialiased; aliased = None };
+      width = float_of_int width;
+      height = float_of_int height;
+      scale = 1.0;
+      quality = Quality.settings Quality.High;
+      dynamic_scale = 1.0;
+      offscreen = Render_target.create ();
+    }
+
+  let resize state ~width ~height ~scale =
+    {
+      state with
+      width = float_of_int width;
+      height = float_of_int height;
+      scale;
+    }
+
+  let set_quality state quality = { state with quality }
+
+  (* Render scale requested for animation, on top of the quality tier's *)
+  let set_dynamic_scale state scale =
+    { state with dynamic_scale = Float.min 1.0 (Float.max 0.1 scale) }
+
+  let dynamic_scale state = state.dynamic_scale
+
+  (* A renderer for another window on the same GL context. The Wall renderer,
+     and with it the glyph atlas and tessellation buffers, is shared. *)
+  let share state ~width ~height =
+    {
+      state with
+      width = float_of_int width;
+      height = float_of_int height;
+      offscreen = Render_target.create ();
+    }
+
+  let wall_renderer state =
+    if state.quality.antialias then
+      state.wall_renderers.antialiased
+    else
+      match state.wall_renderers.aliased with
+      | Some renderer ->
+          renderer
+      | None ->
+          let renderer = Wall.Renderer.create ~antialias:false () in
+          state.wall_renderers.aliased <- Some renderer;
+          renderer
 
   let color_to_paint (color : Color.t) =
     Wall.Paint.rgba
@@ -40,6 +100,36 @@ module Renderer = struct
       (float_of_int color.b /. 255.0)
       (float_of_int color.a /. 255.0)
 
+  (* Keeps every [stride]th point, and always the last one so closed shapes
+     stay closed *)
+  let decimate_path stride points =
+    if stride <= 1 then
+      points
+    else
+      let rec keep i = function
+        | [] ->
+            []
+        | [ last ] ->
+            [ last ]
+        | point :: rest ->
+            if i mod stride = 0 then
+              point :: keep (i + 1) rest
+            else
+              keep (i + 1) rest
+      in
+      keep 0 points
+
+  let polyline ctx bounds points =
+    let count = Float.Array.length points / 2 in
+    for i = 0 to count - 1 do
+      let x = bounds.x +. Float.Array.get points (2 * i) in
+      let y = bounds.y +. Float.Array.get points ((2 * i) + 1) in
+      if i = 0 then
+        Wall.Path.move_to ctx ~x ~y
+      else
+        Wall.Path.line_to ctx ~x ~y
+    done
+
   let render_shape_fill bounds = function
     | `Rectangle ->
         Wall.Image.fill_path (fun ctx ->
@@ -67,6 +157,13 @@ module Renderer = struct
             Wall.Image.fill_path (fun ctx ->
                 Wall.Path.move_to ctx ~x:first_x ~y:first_y;
                 List.iter (fun (x, y) -> Wall.Path.line_to ctx ~x ~y) rest))
+    | `Polyline points ->
+        Wall.Image.fill_path (fun ctx -> polyline ctx bounds points)
+    | `Raster _ ->
+        (* Drawn between Wall batches, see [scene_layers] *)
+        Wall.Image.empty
+    | `Text_lines _ ->
+        Wall.Image.empty
 
   let render_shape_stroke bounds stroke_width = function
     | `Rectangle ->
@@ -100,81 +197,154 @@ module Renderer = struct
               (fun ctx ->
                 Wall.Path.move_to ctx ~x:first_x ~y:first_y;
                 List.iter (fun (x, y) -> Wall.Path.line_to ctx ~x ~y) rest))
+    | `Polyline points ->
+        Wall.Image.stroke_path (Wall.Outline.make ~width:stroke_width ())
+          (fun ctx -> polyline ctx bounds points)
+    | `Raster _ | `Text_lines _ ->
+        Wall.Image.empty
 
-  let render_primitive_node (node : render_primitive) =
-    let bounds = node.bounds in
-    match node.style with
-    | RenderStyle.Fill color ->
-        Wall.Image.paint (color_to_paint color)
-          (render_shape_fill bounds node.shape)
-    | RenderStyle.Stroke (color, stroke_width) ->
-        Wall.Image.paint (color_to_paint color)
-          (render_shape_stroke bounds stroke_width node.shape)
-    | RenderStyle.FillAndStroke (fill_color, stroke_color, stroke_width) ->
-        Wall.Image.seq
-          [
-            Wall.Image.paint
-              (color_to_paint fill_color)
-              (render_shape_fill bounds node.shape);
-            Wall.Image.paint
-              (color_to_paint stroke_color)
-              (render_shape_stroke bounds stroke_width node.shape);
-          ]
-    | RenderStyle.Text (color, text, text_x, text_y, font_size) -> (
-        match Lazy.force default_font with
-        | None ->
-            let placeholder =
-              Wall.Image.fill_path (fun ctx ->
-                  Wall.Path.circle ctx ~cx:(float_of_int text_x)
-                    ~cy:(float_of_int text_y) ~r:8.0)
-            in
-            let fallback = Color.make ~r:255 ~g:0 ~b:0 () in
-            Wall.Image.paint (color_to_paint fallback) placeholder
-        | Some font_data ->
-            let font = Wall_text.Font.make ~size:font_size font_data in
-            Wall.Image.paint (color_to_paint color)
-              (Wall_text.simple_text font ~x:(float_of_int text_x)
-                 ~y:(float_of_int text_y) ~halign:`CENTER ~valign:`MIDDLE text))
-
-  let render_node ~x ~y node =
-    Layout.layout_node_impl ~x ~y node
-    |> List.map render_primitive_node
-    |> Wall.Image.seq
-
-  let render_primitives_list primitives =
-    primitives |> List.map render_primitive_node |> Wall.Image.seq
+  (* Editor lines, and a caret measured with the same font *)
+  let render_text_lines bounds color (text : text_lines) =
+    match Lazy.force default_font with
+    | None ->
+        Wall.Image.empty
+    | Some font_data ->
+        let font = Wall_text.Font.make ~size:text.font_size font_data in
+        let paint = color_to_paint color in
+        let row_y row = bounds.y +. (float_of_int row *. text.line_height) in
+        let line row content =
+          Wall.Image.paint paint
+            (Wall_text.simple_text font ~x:bounds.x ~y:(row_y row) ~halign:`LEFT
+               ~valign:`TOP content)
+        in
+        let caret =
+          match text.caret with
+          | None ->
+              Wall.Image.empty
+          | Some (row, column) ->
+              let x =
+                bounds.x
+                +. Wall_text.Font.text_width font
+                     (String.sub text.lines.(row) 0 column)
+              in
+              Wall.Image.paint paint
+                (Wall.Image.fill_path (fun ctx ->
+                     Wall.Path.rect ctx ~x ~y:(row_y row) ~w:1.0
+                       ~h:text.line_height))
+        in
+        Wall.Image.seq (caret :: Array.to_list (Array.mapi line text.lines))
 
-  let render_view ?(fps = 0.0) state node () =
-    (* Clear screen by rendering a full-screen background *)
-    let clear_background =
-      Wall.Image.paint
-        (Wall.Paint.color (Wall.Color.v 0.0 0.0 0.0 1.0))
-        (Wall.Image.fill_path (fun ctx ->
-             Wall.Path.rect ctx ~x:0.0 ~y:0.0 ~w:state.width ~h:state.height))
+  let render_primitive_node (quality : Quality.settings)
+      (node : render_primitive) =
+    let bounds = node.bounds in
+    let node =
+      match node.shape with
+      | `Path points when quality.path_stride > 1 ->
+          { node with shape = `Path (decimate_path quality.path_stride points) }
+      | _ ->
+          node
+    in
+    let style =
+      match node.style with
+      | RenderStyle.FillAndStroke (fill_color, _, _)
+        when not quality.decorations ->
+          RenderStyle.Fill fill_color
+      | style ->
+          style
     in
-    let scene = render_node ~x:0 ~y:0 node in
-    let fps_text =
-      if fps > 0.0 then
-        let fps_color = Color.make ~r:0 ~g:255 ~b:0 () in
-        Wall.Image.paint (color_to_paint fps_color)
-          (match Lazy.force default_font with
+    if node.decorative && not quality.decorations then
+      Wall.Image.empty
+    else
+      match (node.shape, style) with
+      | `Text_lines text, RenderStyle.Fill color ->
+          render_text_lines bounds color text
+      | _, RenderStyle.Fill color ->
+          Wall.Image.paint (color_to_paint color)
+            (render_shape_fill bounds node.shape)
+      | _, RenderStyle.Stroke (color, stroke_width) ->
+          Wall.Image.paint (color_to_paint color)
+            (render_shape_stroke bounds stroke_width node.shape)
+      | _, RenderStyle.FillAndStroke (fill_color, stroke_color, stroke_width)
+        ->
+          Wall.Image.seq
+            [
+              Wall.Image.paint
+                (color_to_paint fill_color)
+                (render_shape_fill bounds node.shape);
+              Wall.Image.paint
+                (color_to_paint stroke_color)
+                (render_shape_stroke bounds stroke_width node.shape);
+            ]
+      | _, RenderStyle.Text (color, text, text_x, text_y, font_size) -> (
+          match Lazy.force default_font with
           | None ->
-              Wall.Image.empty
+              let placeholder =
+                Wall.Image.fill_path (fun ctx ->
+                    Wall.Path.circle ctx ~cx:(float_of_int text_x)
+                      ~cy:(float_of_int text_y) ~r:8.0)
+              in
+              let fallback = Color.make ~r:255 ~g:0 ~b:0 () in
+              Wall.Image.paint (color_to_paint fallback) placeholder
           | Some font_data ->
-              let font = Wall_text.Font.make ~size:14.0 font_data in
-              let x = state.width -. 10.0 in
-              Wall_text.simple_text font ~x ~y:20.0 ~halign:`RIGHT ~valign:`TOP
-                (Printf.sprintf "FPS: %.1f" fps))
-      else
-        Wall.Image.empty
+              let font = Wall_text.Font.make ~size:font_size font_data in
+              Wall.Image.paint (color_to_paint color)
+                (Wall_text.simple_text font ~x:(float_of_int text_x)
+                   ~y:(float_of_int text_y) ~halign:`CENTER ~valign:`MIDDLE
+                   text))
+
+  (* A scene is a list of layers in drawing order: [`Wall] batches of
+     primitives, and the [`Raster]s between them, which are textures of their
+     own and do not go through Wall. A scene without rasters is one batch. *)
+  let scene_layers ~quality (primitives : render_primitive array) count =
+    let layers = ref [] and images = ref [] in
+    let flush () =
+      match !images with
+      | [] ->
+          ()
+      | batch ->
+          layers := `Wall (Wall.Image.seq batch) :: !layers;
+          images := []
     in
-    let final_scene = Wall.Image.seq [ clear_background; scene; fps_text ] in
-    Wall.Renderer.render state.wall_renderer ~width:state.width
-      ~height:state.height
-      ~performance_counter:(Wall.Performance_counter.make ())
-      final_scene
+    for i = count - 1 downto 0 do
+      let primitive = primitives.(i) in
+      match primitive.shape with
+      | `Raster raster ->
+          flush ();
+          layers := `Raster (primitive.bounds, raster) :: !layers
+      | _ ->
+          images := render_primitive_node quality primitive :: !images
+    done;
+    flush ();
+    !layers
+
+  let render_node ~quality ~x ~y node =
+    let primitives = Array.of_list (Layout.layout_node_impl ~x ~y node) in
+    scene_layers ~quality primitives (Array.length primitives)
 
-  let render_view_with_primitives ?(fps = 0.0) state primitives () =
+  let render_primitive_buffer ~quality (primitives : primitive_buffer) =
+    scene_layers ~quality primitives.items primitives.count
+
+  let fps_overlay state fps =
+    if fps > 0.0 then
+      let fps_color = Color.make ~r:0 ~g:255 ~b:0 () in
+      Wall.Image.paint (color_to_paint fps_color)
+        (match Lazy.force default_font with
+        | None ->
+            Wall.Image.empty
+        | Some font_data ->
+            let font = Wall_text.Font.make ~size:14.0 font_data in
+            let x = state.width -. 10.0 in
+            Wall_text.simple_text font ~x ~y:20.0 ~halign:`RIGHT ~valign:`TOP
+              (Printf.sprintf "FPS: %.1f" fps))
+    else
+      Wall.Image.empty
+
+  (* Renders [scene] to the drawable of the current window. The scene is laid
+     out in window coordinates and scaled up to drawable pixels, so text and
+     antialiasing stay crisp on HiDPI displays. [stretch] additionally scales
+     the scene alone, which is used to reuse the previous frame while a
+     window is being resized. *)
+  let render_scene ?(fps = 0.0) ?(stretch = (1.0, 1.0)) state layers =
     (* Clear screen by rendering a full-screen background *)
     let clear_background =
       Wall.Image.paint
@@ -182,25 +352,82 @@ module Renderer = struct
         (Wall.Image.fill_path (fun ctx ->
              Wall.Path.rect ctx ~x:0.0 ~y:0.0 ~w:state.width ~h:state.height))
     in
-    let scene = render_primitives_list primitives in
-    let fps_text =
-      if fps > 0.0 then
-        let fps_color = Color.make ~r:0 ~g:255 ~b:0 () in
-        Wall.Image.paint (color_to_paint fps_color)
-          (match Lazy.force default_font with
-          | None ->
-              Wall.Image.empty
-          | Some font_data ->
-              let font = Wall_text.Font.make ~size:14.0 font_data in
-              let x = state.width -. 10.0 in
-              Wall_text.simple_text font ~x ~y:20.0 ~halign:`RIGHT ~valign:`TOP
-                (Printf.sprintf "FPS: %.1f" fps))
-      else
-        Wall.Image.empty
+    let stretch_x, stretch_y = stretch in
+    let stretched image =
+      match stretch with
+      | 1.0, 1.0 ->
+          image
+      | _ ->
+          Wall.Image.transform (Wall.Transform.scale stretch_x stretch_y) image
     in
-    let final_scene = Wall.Image.seq [ clear_background; scene; fps_text ] in
-    Wall.Renderer.render state.wall_renderer ~width:state.width
-      ~height:state.height
-      ~performance_counter:(Wall.Performance_counter.make ())
-      final_scene
+    (* Adjacent batches are merged so a scene without rasters, the common
+       case, is still rendered by Wall in one go *)
+    let rec merge = function
+      | `Wall first :: `Wall second :: rest ->
+          merge (`Wall (Wall.Image.seq [ first; second ]) :: rest)
+      | layer :: rest ->
+          layer :: merge rest
+      | [] ->
+          []
+    in
+    let layers =
+      merge
+        ((`Wall clear_background
+         :: List.map
+              (function
+                | `Wall image ->
+                    `Wall (stretched image)
+                | `Raster _ as raster ->
+                    raster)
+              layers)
+        @ [ `Wall (fps_overlay state fps) ])
+    in
+    let pixel_width = state.width *. state.scale in
+    let pixel_height = state.height *. state.scale in
+    let render_scale =
+      Float.min state.quality.render_scale state.dynamic_scale
+    in
+    let target_width = int_of_float (pixel_width *. render_scale) in
+    let target_height = int_of_float (pixel_height *. render_scale) in
+    let render_layers ~width ~height ~scale =
+      let performance_counter = Wall.Performance_counter.make () in
+      List.iter
+        (function
+          | `Wall image ->
+              Wall.Renderer.render (wall_renderer state) ~width ~height
+                ~performance_counter
+                (Wall.Image.transform (Wall.Transform.scale scale scale) image)
+          | `Raster ((bounds : bounds), raster) ->
+              let scale_x = scale *. stretch_x in
+              let scale_y = scale *. stretch_y in
+              Raster.draw raster ~viewport_width:width ~viewport_height:height
+                ~x:(bounds.x *. scale_x) ~y:(bounds.y *. scale_y)
+                ~w:(bounds.width *. scale_x) ~h:(bounds.height *. scale_y))
+        layers
+    in
+    if
+      render_scale < 1.0 && target_width > 0 && target_height > 0
+      && Render_target.bind state.offscreen ~width:target_width
+           ~height:target_height
+    then begin
+      (* Fill-rate bound scenes: render fewer pixels, upscale once *)
+      render_layers
+        ~width:(float_of_int target_width)
+        ~height:(float_of_int target_height)
+        ~scale:(state.scale *. render_scale);
+      Render_target.present state.offscreen ~width:(int_of_float pixel_width)
+        ~height:(int_of_float pixel_height)
+    end
+    else begin
+      Tgles2.Gl.viewport 0 0 (int_of_float pixel_width)
+        (int_of_float pixel_height);
+      render_layers ~width:pixel_width ~height:pixel_height ~scale:state.scale
+    end
+
+  let render_view ?fps state node () =
+    render_scene ?fps state (render_node ~quality:state.quality ~x:0 ~y:0 node)
+
+  let render_view_with_primitives ?fps ?stretch state primitives () =
+    render_scene ?fps ?stretch state
+      (render_primitive_buffer ~quality:state.quality primitives)
 end
@@ -7,6 +7,76 @@ let ( let* ) result f =
 module Renderer = Renderer.Renderer
 
 module Engine = struct
+  (* Per-window runtime state. All windows share one GL context and one Wall
+     renderer, so fonts, glyphs and tessellation buffers are only kept once. *)
+  type ('model, 'msg) window_state = {
+    config : Window.t;
+    sdl_window : Sdl.window;
+    window_id : int;
+    view : 'model -> 'msg node;
+    mutable renderer : Renderer.state;
+    mutable width : int;
+    mutable height : int;
+    (* Last layout, kept to stretch it while a resize is in flight *)
+    mutable laid_out_size : int * int;
+    (* Primitives of the last layout, and the buffer filled the layout
+       before; the next layout reuses the older one *)
+    mutable primitives : primitive_buffer;
+    mutable previous_primitives : primitive_buffer;
+    mutable last_relayout : int32;
+    mutable resizing : bool;
+    mutable last_resize_event : int32;
+    (* The tree hit-tested against, and the one filled the frame before; the
+       next layout reuses the older one's storage *)
+    mutable node_tree : 'msg bounds_tree;
+    mutable previous_tree : 'msg bounds_tree;
+    mutable retained : 'msg Layout.retained option;
+    hovered_path : path option ref;
+    mutable rendered_model : 'model option;
+    (* Whether series, buffers or rasters drawn last changed since *)
+    mutable content_changed : unit -> bool;
+    mutable dirty : bool;
+    mutable visible : bool;
+    mutable focused : bool;
+    mutable closed : bool;
+    (* Dynamic resolution: how long the last render of this window took,
+       from layout until the GPU finished but without the swap, whether the
+       previous iteration rendered too, and whether the scale was set by a
+       command *)
+    mutable render_ms : float;
+    mutable continuous : bool;
+    mutable pinned_scale : bool;
+  }
+
+  (* Loop rate while every window is hidden and none asked for a specific
+     background rate; subscriptions still run, nothing is rendered. *)
+  let hidden_fps = 10
+
+  (* Per-frame budgets of the message lanes. Input is handled first and only
+     capped so that a stuck event source cannot stall rendering. Animation
+     frame messages come once per subscription per frame. Background messages
+     get a bounded slice; the rest wait for the next frame. *)
+  let input_events_per_frame = 1024
+  let tray_messages_per_frame = 32
+  let background_messages_per_frame = 1024
+  let background_budget_ms = 4.0
+
+  (* The slack of a frame lasts until a frame of this length, or the
+     throttled frame interval, is over, but no longer than the cap so that
+     work done in it cannot hold up input for long. Tasks get at least the
+     minimum slice. *)
+  let slack_frame_ms = 1000.0 /. 60.0
+  let max_slack_ms = 50.0
+  let min_task_ms = 1.0
+
+  (* Slack that is always enough to sample the model, however long the last
+     sample took; below [max_slack_ms] so that idle frames have it *)
+  let model_sample_slack_ms = 40.0
+
+  (* Frame budget and step size for automatic render-resolution scaling *)
+  let dynamic_resolution_budget_ms = 1000.0 /. 60.0
+  let dynamic_resolution_step = 0.125
+
   let mouse_button_of_sdl = function
     | 1 ->
         Ui_event.Left
@@ -53,66 +123,217 @@ module Engine = struct
     | `Key_up ->
         let keycode = Sdl.Event.(get sdl_event keyboard_keycode) in
         Some (Ui_event.KeyUp (Sdl.get_key_name keycode))
+    | `Text_input ->
+        Some (Ui_event.TextInput Sdl.Event.(get sdl_event text_input_text))
+    | _ ->
+        None
+
+  let window_id_of_sdl sdl_event =
+    match Sdl.Event.(enum (get sdl_event typ)) with
+    | `Mouse_button_down | `Mouse_button_up ->
+        Some Sdl.Event.(get sdl_event mouse_button_window_id)
+    | `Mouse_motion ->
+        Some Sdl.Event.(get sdl_event mouse_motion_window_id)
+    | `Key_down | `Key_up ->
+        Some Sdl.Event.(get sdl_event keyboard_window_id)
+    | `Text_input ->
+        Some Sdl.Event.(get sdl_event text_input_window_id)
+    | `Window_event ->
+        Some Sdl.Event.(get sdl_event window_window_id)
     | _ ->
         None
 
-  let run ~(window : Window.t) ~init ~update ~view ~subscriptions ~is_quit
-      ~render : (unit, [> `Msg of string ]) result =
-    let width = window.width in
-    let height = window.height in
-    let window_title = window.title in
+  (* A window is redrawn when the model it last rendered is no longer the
+     current one, when something outside the model (expose, resize) marked
+     it dirty, or when a series, buffer or raster it draws changed. *)
+  let needs_render model w =
+    w.dirty || w.content_changed ()
+    ||
+    match w.rendered_model with
+    | Some rendered ->
+        rendered != model
+    | None ->
+        true
 
+  let run ~(windows : (Window.t * ('model -> 'msg node)) list) ~quality ~init
+      ~update ~subscriptions ~msg_name ~slow_update_ms ~model_sample_ms ~is_quit
+      ~render :
+      (unit, [> `Msg of string ]) result =
     let* () = Sdl.init Sdl.Init.(video + events) in
+    Wakeup.init ();
 
     Sdl.gl_set_attribute Sdl.Gl.context_major_version 2 |> ignore;
     Sdl.gl_set_attribute Sdl.Gl.context_minor_version 1 |> ignore;
 
-    let* window =
-      Sdl.create_window window_title ~w:width ~h:height
-        Sdl.Window.(opengl + resizable)
+    let* created =
+      List.fold_left
+        (fun acc ((config : Window.t), view) ->
+          let* created = acc in
+          let* sdl_window =
+            Sdl.create_window config.title ~w:config.width ~h:config.height
+              Sdl.Window.(opengl + resizable + allow_highdpi)
+          in
+          Ok ((config, view, sdl_window) :: created))
+        (Ok []) windows
     in
+    let created = List.rev created in
+    let* first_config, first_window =
+      match created with
+      | (config, _, sdl_window) :: _ ->
+          Ok (config, sdl_window)
+      | [] ->
+          Error (`Msg "Engine.run: no windows given")
+    in
+
+    (* One context for every window: SDL lets any window with a GL-capable
+       surface make it current, which keeps all GPU resources in one place. *)
+    let* gl_context = Sdl.gl_create_context first_window in
+    let* () = Sdl.gl_make_current first_window gl_context in
 
-    let* gl_context = Sdl.gl_create_context window in
-    let* () = Sdl.gl_make_current window gl_context in
+    let shared_renderer =
+      Renderer.create ~width:first_config.width ~height:first_config.height
+    in
+    let windows =
+      List.map
+        (fun ((config : Window.t), view, sdl_window) ->
+          {
+            config;
+            sdl_window;
+            window_id = Sdl.get_window_id sdl_window;
+            view;
+            renderer =
+              Renderer.share shared_renderer ~width:config.width
+                ~height:config.height;
+            width = config.width;
+            height = config.height;
+            laid_out_size = (config.width, config.height);
+            primitives = Primitive_buffer.create ();
+            previous_primitives = Primitive_buffer.create ();
+            last_relayout = 0l;
+            resizing = false;
+            last_resize_event = 0l;
+            node_tree = Bounds_tree.create ();
+            previous_tree = Bounds_tree.create ();
+            retained = None;
+            hovered_path = ref None;
+            rendered_model = None;
+            content_changed = (fun () -> false);
+            dirty = true;
+            visible = true;
+            focused = true;
+            closed = false;
+            render_ms = 0.0;
+            continuous = false;
+            pinned_scale = false;
+          })
+        created
+    in
+    (* Window size in window coordinates drives layout; the drawable size only
+       determines how many pixels the renderer produces. *)
+    let update_window_size w =
+      let width, height = Sdl.get_window_size w.sdl_window in
+      let drawable_width, _ = Sdl.gl_get_drawable_size w.sdl_window in
+      let scale =
+        if width > 0 then
+          float_of_int drawable_width /. float_of_int width
+        else
+          1.0
+      in
+      w.width <- width;
+      w.height <- height;
+      w.renderer <- Renderer.resize w.renderer ~width ~height ~scale
+    in
+    List.iter update_window_size windows;
 
-    let renderer_state = Renderer.create ~width ~height in
+    let find_window id = List.find_opt (fun w -> w.window_id = id) windows in
+    let window_of_sdl sdl_event =
+      Option.bind (window_id_of_sdl sdl_event) find_window
+    in
 
     let model = ref init in
     let event = Sdl.Event.create () in
-    let node_tree = ref None in
-    let hovered_path = ref None in
     let active_subs = ref Subscription.none in
     let has_animation_frame_sub = ref false in
+    (* Per fixed-step subscription, in order, its rate and the real time not
+       yet handed out as steps; and when that time was last measured *)
+    let fixed_steps = ref [||] in
+    let last_fixed_step = ref None in
+    (* Earliest time, in SDL ticks, at which a throttled subtree asked to be
+       refreshed, or [max_int] *)
+    let throttled_refresh_at = ref max_int in
+    throttle_clock.now <- (fun () -> Int32.to_int (Sdl.get_ticks ()));
+    throttle_clock.refresh_at <-
+      (fun at ->
+        if at < !throttled_refresh_at then begin
+          throttled_refresh_at := at;
+          Wakeup.after ~ms:(at - Int32.to_int (Sdl.get_ticks ()))
+        end);
     let active_tray_subs : (Tray.t * (unit -> unit)) list ref = ref [] in
 
+    let iter_open_windows f =
+      List.iter (fun w -> if not w.closed then f w) windows
+    in
+
     (* Helper to execute commands *)
     let rec execute_cmd cmd =
       match cmd with
       | Cmd.ShowWindow ->
           Printf.printf "[Runtime] Executing ShowWindow\n%!";
-          Sdl.show_window window
+          iter_open_windows (fun w ->
+              Sdl.show_window w.sdl_window;
+              w.visible <- true)
       | Cmd.HideWindow ->
           Printf.printf "[Runtime] Executing HideWindow\n%!";
-          Sdl.hide_window window
+          iter_open_windows (fun w ->
+              Sdl.hide_window w.sdl_window;
+              w.visible <- false)
       | Cmd.FocusWindow ->
           Printf.printf "[Runtime] Executing FocusWindow\n%!";
-          Sdl.show_window window;
-          Sdl.raise_window window
+          iter_open_windows (fun w ->
+              Sdl.show_window w.sdl_window;
+              Sdl.raise_window w.sdl_window;
+              w.visible <- true)
+      | Cmd.SetRenderScale scale ->
+          Printf.printf "[Runtime] Executing SetRenderScale %.2f\n%!" scale;
+          iter_open_windows (fun w ->
+              w.renderer <- Renderer.set_dynamic_scale w.renderer scale;
+              w.pinned_scale <- true)
       | Cmd.None ->
           ()
       | Cmd.Batch cmds ->
           List.iter execute_cmd cmds
     in
 
-    let dispatch_to_node event node_info =
+    let milliseconds_since counter =
+      Int64.to_float (Int64.sub (Sdl.get_performance_counter ()) counter)
+      *. 1000.0
+      /. Int64.to_float (Sdl.get_performance_frequency ())
+    in
+
+    (* Every message goes through here, so each update is timed and charged
+       to its message's name in Stats *)
+    let apply_msg msg =
+      let start = Sdl.get_performance_counter () in
+      let new_model, cmd = update msg !model in
+      let ms = milliseconds_since start in
+      model := new_model;
+      let name = msg_name msg in
+      Stats.record_update ~name ~ms;
+      (match slow_update_ms with
+      | Some threshold when ms > threshold ->
+          Printf.eprintf "[Runtime] Slow update: %s took %.1f ms\n%!" name ms
+      | _ ->
+          ());
+      execute_cmd cmd
+    in
+
+    let dispatch_to_node tree event entry =
       match
-        Events.handle_node_event_with_bounds event node_info.node
-          node_info.bounds
+        Events.handle_node_event_with_bounds event (Bounds_tree.node tree entry)
+          (Bounds_tree.bounds tree entry)
       with
       | Some msg ->
-          let new_model, cmd = update msg !model in
-          model := new_model;
-          execute_cmd cmd;
+          apply_msg msg;
           true
       | None ->
           false
@@ -124,10 +345,414 @@ module Engine = struct
     let current_fps = ref 0.0 in
     let show_fps = ref false in
     let debug_layout = Sys.getenv_opt "UI_DEBUG_LAYOUT" <> None in
+    let governor = Option.map Governor.create quality in
+    let frame_rendered = ref false in
     let last_layout_log = ref 0l in
+    (* Sizes of the trees laid out this frame, summed over windows *)
+    let frame_nodes = ref 0 in
+    let frame_primitives = ref 0 in
+    let last_model_sample = ref neg_infinity in
+    let model_sample_queued = ref false in
+    (* How long the last model sample took, in milliseconds *)
+    let model_sample_cost = ref 0.0 in
+
+    let handle_window_event sdl_event =
+      match window_of_sdl sdl_event with
+      | None ->
+          ()
+      | Some w -> (
+          match
+            Sdl.Event.(window_event_enum (get sdl_event window_event_id))
+          with
+          | `Close ->
+              (* Closing one window of several only hides it; the app quits
+                 once the last one is gone. *)
+              w.closed <- true;
+              Sdl.hide_window w.sdl_window
+          | `Size_changed | `Resized ->
+              (* Relayout is throttled in the loop while these keep coming *)
+              update_window_size w;
+              w.resizing <- true;
+              w.last_resize_event <- Sdl.get_ticks ();
+              w.dirty <- true
+          | `Moved ->
+              (* Moving to another display can change the drawable scale *)
+              update_window_size w
+          | `Exposed | `Shown | `Restored ->
+              w.visible <- true;
+              w.dirty <- true
+          | `Hidden | `Minimized ->
+              w.visible <- false
+          | `Focus_gained ->
+              w.focused <- true
+          | `Focus_lost ->
+              w.focused <- false
+          | _ ->
+              ())
+    in
+
+    (* Highest frame rate any open window currently asks for, as a frame
+       interval in milliseconds. [None] means unthrottled. *)
+    let frame_interval_ms () =
+      let caps =
+        List.filter_map
+          (fun w ->
+            if w.closed then
+              None
+            else if not w.visible then
+              Some
+                (Some
+                   (Option.value w.config.background_fps ~default:hidden_fps))
+            else if w.focused then
+              Some None
+            else
+              Some w.config.background_fps)
+          windows
+      in
+      if List.exists Option.is_none caps then
+        None
+      else
+        match List.filter_map Fun.id caps with
+        | [] ->
+            None
+        | fps :: rest ->
+            Some (1000 / max 1 (List.fold_left max fps rest))
+    in
+
+    (* Nothing animates and no window has anything new to show, so the loop
+       can block until an event, a wakeup or a deadline arrives. *)
+    let is_idle () =
+      (not !has_animation_frame_sub)
+      && (not !show_fps)
+      && List.for_all
+           (fun w ->
+             w.closed || (not w.visible)
+             || not
+                  (w.resizing
+                  || needs_render !model w
+                  || Renderer.dynamic_scale w.renderer < 1.0))
+           windows
+    in
+
+    (* Apps see visibility and focus of the application as a whole: visible
+       while any window is, focused while any window has focus. *)
+    let app_visible = ref true in
+    let app_focused = ref true in
+    let notify_window_state () =
+      let visible =
+        List.exists (fun w -> (not w.closed) && w.visible) windows
+      in
+      let focused =
+        List.exists (fun w -> (not w.closed) && w.focused) windows
+      in
+      if visible <> !app_visible || focused <> !app_focused then begin
+        let visibility_changed = visible <> !app_visible in
+        let focus_changed = focused <> !app_focused in
+        app_visible := visible;
+        app_focused := focused;
+        let flattened = Subscription.flatten !active_subs in
+        List.iter
+          (fun sub ->
+            let msg =
+              match sub with
+              | Subscription.VisibilityChange f when visibility_changed ->
+                  Some (f visible)
+              | Subscription.FocusChange f when focus_changed ->
+                  Some (f focused)
+              | _ ->
+                  None
+            in
+            match msg with
+            | Some msg ->
+                apply_msg msg
+            | None ->
+                ())
+          flattened
+      end
+    in
+
+    let render_window ~fps w =
+      match Sdl.gl_make_current w.sdl_window gl_context with
+      | Error (`Msg e) ->
+          Printf.eprintf "[Runtime] Could not make GL context current: %s\n%!"
+            e
+      | Ok () ->
+          let render_start = Sdl.get_performance_counter () in
+          let rendered_model = !model in
+          let scene = w.view rendered_model in
+          let tree = w.previous_tree in
+          w.previous_tree <- w.node_tree;
+          let primitives = w.previous_primitives in
+          w.previous_primitives <- w.primitives;
+          let retained =
+            Layout.layout_retained ?previous:w.retained ~tree
+              ~last_tree:w.previous_tree ~primitives
+              ~last_primitives:w.previous_primitives ~width:w.width
+              ~height:w.height scene
+          in
+          w.retained <- Some retained;
+          w.content_changed <- Layout.changed_since tree;
+          w.node_tree <- tree;
+          w.primitives <- primitives;
+          frame_nodes := !frame_nodes + tree.length;
+          frame_primitives := !frame_primitives + primitives.count;
+          if debug_layout then begin
+            let now = Sdl.get_ticks () in
+            if Int32.sub now !last_layout_log >= 500l then begin
+              last_layout_log := now;
+              let bounds = Bounds_tree.bounds tree 0 in
+              Printf.printf
+                "[ui] window %d root layout: (x=%.1f, y=%.1f, w=%.1f, h=%.1f)\n"
+                w.window_id bounds.x bounds.y bounds.width bounds.height;
+              (* Entries are stored depth first, in tree order *)
+              for entry = 0 to tree.length - 1 do
+                let depth = Bounds_tree.depth tree entry in
+                let indent = String.make (depth * 2) ' ' in
+                let b = Bounds_tree.bounds tree entry in
+                Printf.printf "%s- x=%.1f y=%.1f w=%.1f h=%.1f\n" indent b.x
+                  b.y b.width b.height
+              done;
+              flush stdout
+            end
+          end;
+          (match !(w.hovered_path) with
+          | Some path ->
+              if Events.find_node_by_path path tree = Bounds_tree.none then
+                w.hovered_path := None
+          | None ->
+              ());
+
+          render ~fps ~stretch:(1.0, 1.0) w.renderer primitives;
+          (* Waits for the GPU so its cost counts, and stops the clock before
+             the swap, which may wait for vblank *)
+          if Option.is_some w.config.dynamic_resolution then
+            Tgles2.Gl.finish ();
+          w.render_ms <- milliseconds_since render_start;
+          Sdl.gl_swap_window w.sdl_window;
+          frame_rendered := true;
+          w.laid_out_size <- (w.width, w.height);
+          w.last_relayout <- Sdl.get_ticks ();
+          w.rendered_model <- Some rendered_model;
+          w.dirty <- false
+    in
+
+    let stretch_last_frame ~fps w =
+      let laid_out_width, laid_out_height = w.laid_out_size in
+      if laid_out_width > 0 && laid_out_height > 0 then
+        match Sdl.gl_make_current w.sdl_window gl_context with
+        | Error (`Msg e) ->
+            Printf.eprintf
+              "[Runtime] Could not make GL context current: %s\n%!" e
+        | Ok () ->
+            let stretch =
+              ( float_of_int w.width /. float_of_int laid_out_width,
+                float_of_int w.height /. float_of_int laid_out_height )
+            in
+            render ~fps ~stretch w.renderer w.primitives;
+            Sdl.gl_swap_window w.sdl_window;
+            frame_rendered := true
+    in
+
+    (* Steps the render scale of an animating window by what its last render
+       cost, not by the time between frames: that is the throttle interval
+       for background windows and on slow displays, and includes the other
+       windows rendered in the same iteration. Only back-to-back frames count,
+       and none while the loop is throttled. *)
+    let adapt_render_scale w =
+      match w.config.dynamic_resolution with
+      | Some min_scale
+        when w.continuous && (not w.pinned_scale)
+             && Option.is_none (frame_interval_ms ()) ->
+          let render_ms = w.render_ms in
+          let scale = Renderer.dynamic_scale w.renderer in
+          let scale =
+            if render_ms > dynamic_resolution_budget_ms *. 1.2 then
+              Float.max min_scale (scale -. dynamic_resolution_step)
+            else if render_ms < dynamic_resolution_budget_ms *. 0.8 then
+              scale +. dynamic_resolution_step
+            else
+              scale
+          in
+          w.renderer <- Renderer.set_dynamic_scale w.renderer scale
+      | _ ->
+          ()
+    in
+
+    (* During a live resize, relayout at most once per throttle interval and
+       once more when the size settles. *)
+    let present_window ~fps w =
+      let rendered =
+        if w.resizing then begin
+          let now = Sdl.get_ticks () in
+          let throttle = Int32.of_int w.config.resize_throttle_ms in
+          let settled = Int32.sub now w.last_resize_event >= throttle in
+          if settled then w.resizing <- false;
+          if settled || Int32.sub now w.last_relayout >= throttle then
+            render_window ~fps w
+          else if w.config.stretch_on_resize then
+            stretch_last_frame ~fps w;
+          false
+        end
+        else if !show_fps || needs_render !model w then begin
+          adapt_render_scale w;
+          render_window ~fps w;
+          true
+        end
+        else if Renderer.dynamic_scale w.renderer < 1.0 then begin
+          (* First idle frame: redraw the settled scene at full resolution *)
+          w.renderer <- Renderer.set_dynamic_scale w.renderer 1.0;
+          w.pinned_scale <- false;
+          render_window ~fps w;
+          false
+        end
+        else
+          false
+      in
+      w.continuous <- rendered
+    in
+
+    let present_visible_window ~fps w =
+      if w.visible then present_window ~fps w
+    in
+
+    let apply_quality_tier tier =
+      Printf.printf "[Runtime] Quality tier: %s\n%!" (Quality.to_string tier);
+      let settings = Quality.settings tier in
+      List.iter
+        (fun w -> w.renderer <- Renderer.set_quality w.renderer settings)
+        windows;
+      (* The tier often changes on the last frame of an animation; redraw so
+         a still screen does not stay at the lower quality *)
+      iter_open_windows (fun w -> w.dirty <- true);
+      Wakeup.wake ();
+      let flattened = Subscription.flatten !active_subs in
+      List.iter
+        (function
+          | Subscription.QualityChange f ->
+              apply_msg (f tier)
+          | _ ->
+              ())
+        flattened
+    in
+
+    (* Only frames that rendered something say anything about the budget *)
+    let observe_frame_time frame_start =
+      match governor with
+      | Some governor when !frame_rendered -> (
+          let frame_ms = milliseconds_since frame_start in
+          match Governor.observe governor ~frame_ms with
+          | Some tier ->
+              apply_quality_tier tier
+          | None ->
+              ())
+      | _ ->
+          ()
+    in
+
+    (* Runs once the frame is on screen. Measuring the model walks all of it
+       and cannot be interrupted, so it is an idle job that waits for a frame
+       with at least as much slack as the last sample took, capped so that
+       idle frames always qualify. Samples are spaced by [model_sample_ms],
+       or further apart so that they take at most one percent of the time as
+       the model grows. *)
+    let record_frame_stats now =
+      let now_ms = Int32.to_float now in
+      if !frame_nodes > 0 then begin
+        Stats.record_frame ~time:(now_ms /. 1000.0) ~nodes:!frame_nodes
+          ~primitives:!frame_primitives;
+        frame_nodes := 0;
+        frame_primitives := 0
+      end;
+      match model_sample_ms with
+      | Some interval
+        when (not !model_sample_queued)
+             && now_ms -. !last_model_sample
+                >= Float.max interval (!model_sample_cost *. 100.0) ->
+          last_model_sample := now_ms;
+          model_sample_queued := true;
+          Idle.schedule ~name:"model sample" (fun ~time_left ->
+              let needed = Float.min !model_sample_cost model_sample_slack_ms in
+              if time_left () < needed then
+                `More
+              else begin
+                model_sample_queued := false;
+                let start = Sdl.get_performance_counter () in
+                let words = Obj.reachable_words (Obj.repr !model) in
+                model_sample_cost := milliseconds_since start;
+                let time = Int32.to_float (Sdl.get_ticks ()) /. 1000.0 in
+                Stats.record_model ~time ~words;
+                `Done
+              end)
+      | _ ->
+          ()
+    in
+
+    (* Subscriptions see input first, then the node under the pointer *)
+    let handle_input ev =
+      List.iter
+        (fun sub ->
+          let msg =
+            match (sub, ev) with
+            | Subscription.KeyUp f, Ui_event.KeyUp key_name
+            | Subscription.KeyDown f, Ui_event.KeyDown key_name ->
+                Some (f key_name)
+            | Subscription.TextInput f, Ui_event.TextInput text ->
+                Some (f text)
+            | Subscription.MouseDown f, Ui_event.MouseDown { x; y; _ }
+            | Subscription.MouseUp f, Ui_event.MouseUp { x; y; _ }
+            | Subscription.MouseMove f, Ui_event.MouseMove { x; y } ->
+                Some (f x y)
+            | _ ->
+                None
+          in
+          Option.iter apply_msg msg)
+        (Subscription.flatten !active_subs);
+      match (window_of_sdl event, ev) with
+      | Some { node_tree = tree; _ }, Ui_event.MouseDown { x; y; _ }
+      | Some { node_tree = tree; _ }, Ui_event.MouseUp { x; y; _ } ->
+          let pos = Position.make ~x ~y in
+          let entry = Events.find_node_at_position pos tree in
+          if entry <> Bounds_tree.none then
+            ignore (dispatch_to_node tree ev entry)
+      | Some ({ node_tree = tree; _ } as w), (Ui_event.MouseMove _ as move) ->
+          ignore
+            (Events.handle_mouse_motion ~tree ~hovered_path:w.hovered_path
+               ~dispatch_to_node:(dispatch_to_node tree) move)
+      | _ ->
+          ()
+    in
+
+    (* Hands inbox messages to update until the background budget for this
+       frame runs out. Returns whether any are left. *)
+    let drain_inboxes () =
+      let start = Sdl.get_performance_counter () in
+      let taken = ref 0 in
+      let rec drain inbox =
+        if
+          !taken < background_messages_per_frame
+          && milliseconds_since start < background_budget_ms
+        then
+          match Inbox.pop inbox with
+          | Some msg ->
+              incr taken;
+              apply_msg msg;
+              drain inbox
+          | None ->
+              ()
+      in
+      let inboxes =
+        List.filter_map
+          (function Subscription.Inbox inbox -> Some inbox | _ -> None)
+          (Subscription.flatten !active_subs)
+      in
+      List.iter drain inboxes;
+      List.exists (fun inbox -> not (Inbox.is_empty inbox)) inboxes
+    in
 
     let rec loop () =
       incr frame_count;
+      let frame_start = Sdl.get_performance_counter () in
+      frame_rendered := false;
       let current_time = Sdl.get_ticks () in
       let frame_delta = Int32.sub current_time !last_frame_time in
       let delta_seconds = Int32.to_float frame_delta /. 1000.0 in
@@ -142,60 +767,52 @@ module Engine = struct
         last_fps_time := current_time
       end;
 
-      let current_width, current_height = Sdl.get_window_size window in
-      let scene = view !model in
-      let tree_with_bounds, render_primitives =
-        Layout.layout_with_bounds_and_primitives ~width:current_width
-          ~height:current_height scene
-      in
-      node_tree := Some tree_with_bounds;
-      if debug_layout then begin
-        let now = Sdl.get_ticks () in
-        if Int32.sub now !last_layout_log >= 500l then begin
-          last_layout_log := now;
-          let bounds = tree_with_bounds.bounds in
-          Printf.printf "[ui] root layout: (x=%.1f, y=%.1f, w=%.1f, h=%.1f)\n"
-            bounds.x bounds.y bounds.width bounds.height;
-          let rec dump depth node =
-            let indent = String.make (depth * 2) ' ' in
-            let b = node.bounds in
-            Printf.printf "%s- x=%.1f y=%.1f w=%.1f h=%.1f\n" indent b.x b.y
-              b.width b.height;
-            List.iter (dump (depth + 1)) node.children
-          in
-          dump 0 tree_with_bounds;
-          flush stdout
-        end
-      end;
-      (match !hovered_path with
-      | Some path ->
-          if Option.is_none (Events.find_node_by_path path tree_with_bounds)
-          then
-            hovered_path := None
-      | None ->
-          ());
-
       let fps_to_show =
         if !show_fps then
           !current_fps
         else
           0.0
       in
-      render ~fps:fps_to_show renderer_state render_primitives;
-      Sdl.gl_swap_window window;
+      if !throttled_refresh_at <= Int32.to_int current_time then begin
+        throttled_refresh_at := max_int;
+        iter_open_windows (fun w -> w.dirty <- true)
+      end;
+      (* The FPS overlay changes every frame, so it forces a redraw *)
+      iter_open_windows (present_visible_window ~fps:fps_to_show);
+      observe_frame_time frame_start;
+      record_frame_stats current_time;
 
       (* Update subscriptions based on current model *)
       let new_subs = subscriptions !model in
       if not (Subscription.equal !active_subs new_subs) then begin
         (* Subscriptions changed - update our tracking *)
         active_subs := new_subs;
-        (* Check if we have an animation frame subscription *)
+        (* Check if we have an animation frame subscription; fixed steps
+           keep the loop running the same way *)
         let flattened = Subscription.flatten new_subs in
         has_animation_frame_sub :=
           List.exists
-            (function Subscription.AnimationFrame _ -> true | _ -> false)
+            (function
+              | Subscription.AnimationFrame _ | Subscription.FixedStep _ ->
+                  true
+              | _ ->
+                  false)
             flattened;
 
+        (* Fixed-step subscriptions that stay at the same rate keep their
+           leftover time *)
+        let previous = !fixed_steps in
+        fixed_steps :=
+          List.filter_map
+            (function Subscription.FixedStep { hz; _ } -> Some hz | _ -> None)
+            flattened
+          |> Array.of_list
+          |> Array.mapi (fun i hz ->
+                 if i < Array.length previous && fst previous.(i) = hz then
+                   previous.(i)
+                 else
+                   (hz, 0.0));
+
         (* Update tray subscriptions *)
         let new_tray_subs =
           List.filter_map
@@ -205,9 +822,7 @@ module Engine = struct
                     ( tray,
                       fun () ->
                         Printf.printf "[Runtime] Tray callback fired\n%!";
-                        let new_model, cmd = update msg !model in
-                        model := new_model;
-                        execute_cmd cmd )
+                        apply_msg msg )
               | _ ->
                   None)
             flattened
@@ -243,17 +858,83 @@ module Engine = struct
           (function
             | Subscription.AnimationFrame f ->
                 let msg = f delta_seconds in
-                let new_model, cmd = update msg !model in
-                model := new_model;
-                execute_cmd cmd
+                apply_msg msg
             | _ ->
                 ())
           flattened
       end;
 
-      (* Process tray subscription messages *)
-      let tray_messages = Tray.poll_subscription_messages () in
-      List.iter (fun msg -> msg.Tray.dispatch ()) tray_messages;
+      (* Fixed steps: the real time since the last frame, from the
+         high-resolution counter, is handed out in whole steps and the rest
+         carried over *)
+      if Array.length !fixed_steps = 0 then
+        last_fixed_step := None
+      else begin
+        let now = Sdl.get_performance_counter () in
+        let elapsed =
+          match !last_fixed_step with
+          | Some last ->
+              Int64.to_float (Int64.sub now last)
+              /. Int64.to_float (Sdl.get_performance_frequency ())
+          | None ->
+              0.0
+        in
+        last_fixed_step := Some now;
+        let steps = !fixed_steps in
+        let index = ref 0 in
+        List.iter
+          (function
+            | Subscription.FixedStep { hz; max_steps; step; alpha } ->
+                let i = !index in
+                incr index;
+                let dt = 1.0 /. hz in
+                let pending = ref (snd steps.(i) +. elapsed) in
+                let taken = ref 0 in
+                while !pending >= dt && !taken < max_steps do
+                  apply_msg (step dt);
+                  pending := !pending -. dt;
+                  incr taken
+                done;
+                (* Whole steps beyond [max_steps] are dropped rather than
+                   owed to the next frame *)
+                pending := Float.rem !pending dt;
+                steps.(i) <- (hz, !pending);
+                Option.iter
+                  (fun alpha -> apply_msg (alpha (!pending /. dt)))
+                  alpha
+            | _ ->
+                ())
+          (Subscription.flatten !active_subs)
+      end;
+
+      (* Background lane: tray clicks and inbox messages, within a budget so
+         a flood of them cannot starve rendering or delay input by more than
+         a frame. What is left keeps the loop awake for the next frame. *)
+      let more_tray =
+        Tray.drain_subscription_messages ~limit:tray_messages_per_frame
+          (fun msg -> msg.Tray.dispatch ())
+      in
+      if drain_inboxes () || more_tray then Wakeup.wake ();
+
+      (* Slack: tasks take the rest of the frame, and idle jobs whatever
+         tasks leave. While either has work left, the loop keeps coming
+         around rather than blocking. *)
+      if Task.pending () || Idle.pending () then begin
+        let now () = milliseconds_since frame_start in
+        let slack_end =
+          match frame_interval_ms () with
+          | Some interval ->
+              min (float_of_int interval) max_slack_ms
+          | None ->
+              slack_frame_ms
+        in
+        let more_tasks =
+          Task.pending ()
+          && Task.run ~now ~deadline:(max slack_end (now () +. min_task_ms))
+        in
+        let more_idle = Idle.pending () && Idle.run ~now ~deadline:slack_end in
+        if more_tasks || more_idle then Wakeup.wake ()
+      end;
 
       (* Process quit subscription *)
       let has_quit_sub = ref false in
@@ -262,139 +943,117 @@ module Engine = struct
         (function Subscription.Quit _ -> has_quit_sub := true | _ -> ())
         flattened;
 
-      match Sdl.poll_event (Some event) with
-      | false ->
-          loop ()
-      | true -> (
-          match event_of_sdl show_fps event with
-          | Some ev when is_quit ev ->
-              (* Process quit subscription first *)
-              if !has_quit_sub then begin
-                let flattened = Subscription.flatten !active_subs in
-                List.iter
-                  (function
-                    | Subscription.Quit msg ->
-                        let new_model, cmd = update msg !model in
-                        model := new_model;
-                        execute_cmd cmd
-                    | _ ->
-                        ())
-                  flattened
-              end;
-              ()
-          | Some ev ->
-              (* First, check if subscriptions can handle this event *)
-              let sub_handled = ref false in
-              (match ev with
-              | Ui_event.KeyUp key_name ->
-                  let flattened = Subscription.flatten !active_subs in
-                  List.iter
-                    (function
-                      | Subscription.KeyUp f ->
-                          let msg = f key_name in
-                          let new_model, cmd = update msg !model in
-                          model := new_model;
-                          execute_cmd cmd;
-                          sub_handled := true
-                      | _ ->
-                          ())
-                    flattened
-              | Ui_event.KeyDown key_name ->
-                  let flattened = Subscription.flatten !active_subs in
-                  List.iter
-                    (function
-                      | Subscription.KeyDown f ->
-                          let msg = f key_name in
-                          let new_model, cmd = update msg !model in
-                          model := new_model;
-                          execute_cmd cmd;
-                          sub_handled := true
-                      | _ ->
-                          ())
-                    flattened
-              | Ui_event.MouseDown { x; y; _ } ->
-                  let flattened = Subscription.flatten !active_subs in
-                  List.iter
-                    (function
-                      | Subscription.MouseDown f ->
-                          let msg = f x y in
-                          let new_model, cmd = update msg !model in
-                          model := new_model;
-                          execute_cmd cmd;
-                          sub_handled := true
-                      | _ ->
-                          ())
-                    flattened
-              | Ui_event.MouseUp { x; y; _ } ->
-                  let flattened = Subscription.flatten !active_subs in
-                  List.iter
-                    (function
-                      | Subscription.MouseUp f ->
-                          let msg = f x y in
-                          let new_model, cmd = update msg !model in
-                          model := new_model;
-                          execute_cmd cmd;
-                          sub_handled := true
-                      | _ ->
-                          ())
-                    flattened
-              | Ui_event.MouseMove { x; y } ->
-                  let flattened = Subscription.flatten !active_subs in
-                  List.iter
-                    (function
-                      | Subscription.MouseMove f ->
-                          let msg = f x y in
-                          let new_model, cmd = update msg !model in
-                          model := new_model;
-                          execute_cmd cmd;
-                          sub_handled := true
-                      | _ ->
-                          ())
-                    flattened
+      let process_quit () =
+        if !has_quit_sub then begin
+          let flattened = Subscription.flatten !active_subs in
+          List.iter
+            (function
+              | Subscription.Quit msg ->
+                  apply_msg msg
               | _ ->
-                  ());
-
-              let ui_handled =
-                match (!node_tree, ev) with
-                | Some tree, Ui_event.MouseDown { x; y; _ }
-                | Some tree, Ui_event.MouseUp { x; y; _ } -> (
-                    let pos = Position.make ~x ~y in
-                    match Events.find_node_at_position pos tree with
-                    | Some node_info ->
-                        dispatch_to_node ev node_info
-                    | None ->
-                        false)
-                | Some tree, (Ui_event.MouseMove _ as move) ->
-                    Events.handle_mouse_motion ~tree ~hovered_path
-                      ~dispatch_to_node move
-                | _ ->
-                    false
-              in
-              if (not ui_handled) && not !sub_handled then
-                loop ()
-              else
-                loop ()
-          | None ->
-              loop ())
+                  ())
+            flattened
+        end
+      in
+
+      notify_window_state ();
+
+      (* Throttled frames sleep in wait_event so input still wakes the loop.
+         Idle frames sleep until the next event; native callbacks and other
+         domains get through with Wakeup.wake. *)
+      let has_event =
+        let now = Int32.to_int (Sdl.get_ticks ()) in
+        let elapsed = now - Int32.to_int current_time in
+        let timeout =
+          if is_idle () then
+            None
+          else
+            match frame_interval_ms () with
+            | Some interval when interval > elapsed ->
+                Some (interval - elapsed)
+            | _ ->
+                Some 0
+        in
+        let timeout =
+          match (timeout, Wakeup.timeout_ms ~now) with
+          | Some frame, Some deadline ->
+              Some (min frame deadline)
+          | None, t | t, None ->
+              t
+        in
+        match timeout with
+        | Some 0 ->
+            Sdl.poll_event (Some event)
+        | Some ms ->
+            Sdl.wait_event_timeout (Some event) ms
+        | None -> (
+            match Sdl.wait_event (Some event) with
+            | Ok () ->
+                true
+            | Error (`Msg e) ->
+                Printf.eprintf "[Runtime] Waiting for events failed: %s\n%!" e;
+                false)
+      in
+
+      (* Input lane: the event that ended the wait, and everything queued
+         behind it, is handled before background messages or the next frame
+         get a turn *)
+      let rec take_input taken =
+        let quit =
+          if Wakeup.is_wakeup event then
+            (* Whatever woke us is picked up at the top of the next frame *)
+            false
+          else if Sdl.Event.(enum (get event typ)) = `Window_event then begin
+            handle_window_event event;
+            List.for_all (fun w -> w.closed) windows
+          end
+          else
+            match event_of_sdl show_fps event with
+            | Some ev when is_quit ev ->
+                true
+            | Some ev ->
+                handle_input ev;
+                false
+            | None ->
+                false
+        in
+        if quit then
+          process_quit ()
+        else if taken < input_events_per_frame && Sdl.poll_event (Some event)
+        then
+          take_input (taken + 1)
+        else
+          loop ()
+      in
+      if has_event then
+        take_input 1
+      else
+        loop ()
     in
 
     loop ();
 
     Sdl.gl_delete_context gl_context;
-    Sdl.destroy_window window;
+    List.iter (fun w -> Sdl.destroy_window w.sdl_window) windows;
     Sdl.quit ();
 
     Ok ()
 end
 
-let run ~window ?subscriptions ~init ~update ~view () =
+let run_windows ~windows ?subscriptions ?quality ?msg_name ?slow_update_ms
+    ?model_sample_ms ~init ~update () =
   let subscriptions =
     match subscriptions with Some s -> s | None -> fun _ -> Subscription.none
   in
   let is_quit = function Ui_event.Quit -> true | _ -> false in
-  let render ~fps state primitives =
-    Renderer.render_view_with_primitives ~fps state primitives ()
+  let render ~fps ~stretch state primitives =
+    Renderer.render_view_with_primitives ~fps ~stretch state primitives ()
   in
-  let window_config = window in
-  Engine.run ~window:window_config ~init ~update ~view ~subscriptions ~is_quit
-    ~render
+  let msg_name = Option.value msg_name ~default:Stats.constructor_name in
+  Engine.run ~windows ~quality ~init ~update ~subscriptions ~msg_name
+    ~slow_update_ms ~model_sample_ms ~is_quit ~render
+
+let run ~window ?subscriptions ?quality ?msg_name ?slow_update_ms
+    ?model_sample_ms ~init ~update ~view () =
+  run_windows ~windows:[ (window, view) ] ?subscriptions ?quality ?msg_name
+    ?slow_update_ms ?model_sample_ms ~init ~update ()
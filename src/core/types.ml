@@ -38,190 +38,413 @@ type primitive =
     }
   | Path of { points : (float * float) list; style : primitive_style }
 
+(* The visible lines of an editor, drawn left aligned from the top left
+   corner of the primitive's bounds. [caret] is the row among [lines] and the
+   byte offset in it. *)
+type text_lines = {
+  lines : string array;
+  font_size : float;
+  line_height : float;
+  caret : (int * int) option;
+}
+
 type render_primitive = {
   bounds : bounds;
+  (* [`Polyline] points are [x0; y0; x1; y1; ...], relative to the top left
+     corner of [bounds] *)
   shape :
     [ `Rectangle
     | `RoundedRectangle of float
     | `Ellipse
     | `Circle
-    | `Path of (float * float) list ];
+    | `Path of (float * float) list
+    | `Polyline of Float.Array.t
+    | `Raster of Raster.t
+    | `Text_lines of text_lines ];
   style : RenderStyle.t;
+  decorative : bool;
+}
+
+(* Render primitives of a frame, written by index into storage that is
+   reused from frame to frame and only grows; [frame] changes whenever the
+   buffer is cleared *)
+type primitive_buffer = {
+  mutable count : int;
+  mutable frame : int;
+  mutable items : render_primitive array;
 }
 
 (* Event and Cmd are now external modules *)
 
+type path = int list
+
+(* What a node sends when it is clicked. [Click_msg] holds the message itself
+   and [Click_with] a function with its payload, so building them allocates
+   no closure. *)
+type 'msg click =
+  | No_click : 'msg click
+  | Click : (unit -> 'msg option) -> 'msg click
+  | Click_msg : 'msg -> 'msg click
+  | Click_with : ('p -> 'msg option) * 'p -> 'msg click
+
+(* What a node sends for a pointer event, given the pointer position relative
+   to the node. [Pointer_with] pairs a function, typically defined once at top
+   level, with the payload to call it with instead of a closure over it. *)
+type 'msg pointer =
+  | No_pointer : 'msg pointer
+  | Pointer : (int * int -> 'msg option) -> 'msg pointer
+  | Pointer_msg : 'msg -> 'msg pointer
+  | Pointer_with : ('p -> int * int -> 'msg option) * 'p -> 'msg pointer
+
+(* Event handlers of a node, in one value so that nodes without any share
+   [no_handlers]. [map_msg] wraps them in [Mapped] rather than wrapping each
+   handler in a closure. *)
+type 'msg handlers =
+  | Handlers : {
+      on_click : 'msg click;
+      on_mouse_down : 'msg pointer;
+      on_mouse_up : 'msg pointer;
+      on_mouse_move : 'msg pointer;
+      on_mouse_enter : 'msg pointer;
+      on_mouse_leave : 'msg pointer;
+    }
+      -> 'msg handlers
+  | Mapped : ('a -> 'msg) * 'a handlers -> 'msg handlers
+
+let no_handlers =
+  Handlers
+    {
+      on_click = No_click;
+      on_mouse_down = No_pointer;
+      on_mouse_up = No_pointer;
+      on_mouse_move = No_pointer;
+      on_mouse_enter = No_pointer;
+      on_mouse_leave = No_pointer;
+    }
+
 type 'msg node =
   | View : {
       style : Style.t;
-      children : 'msg node list;
+      children : 'msg node array;
       key : string option;
-      on_click : (unit -> 'msg option) option;
-      on_mouse_down : (int * int -> 'msg option) option;
-      on_mouse_up : (int * int -> 'msg option) option;
-      on_mouse_move : (int * int -> 'msg option) option;
-      on_mouse_enter : (int * int -> 'msg option) option;
-      on_mouse_leave : (int * int -> 'msg option) option;
+      handlers : 'msg handlers;
     }
       -> 'msg node
   | Text : {
       content : string;
       style : Style.t;
       key : string option;
-      on_click : (unit -> 'msg option) option;
+      handlers : 'msg handlers;
     }
       -> 'msg node
   | Canvas : {
       primitives : primitive list;
       style : Style.t;
       key : string option;
-      on_click : (unit -> 'msg option) option;
-      on_mouse_down : (int * int -> 'msg option) option;
-      on_mouse_up : (int * int -> 'msg option) option;
-      on_mouse_move : (int * int -> 'msg option) option;
-      on_mouse_enter : (int * int -> 'msg option) option;
-      on_mouse_leave : (int * int -> 'msg option) option;
+      handlers : 'msg handlers;
     }
       -> 'msg node
+  | Chart : {
+      series : Series.t;
+      style : Style.t;
+      key : string option;
+      color : Color.t;
+      line_width : float;
+      y_range : (float * float) option;
+    }
+      -> 'msg node
+  | Raster : {
+      raster : Raster.t;
+      style : Style.t;
+      key : string option;
+      handlers : 'msg handlers;
+    }
+      -> 'msg node
+  | Editor : {
+      editor : Text_editor.t;
+      style : Style.t;
+      key : string option;
+      handlers : 'msg handlers;
+    }
+      -> 'msg node
+  | Static : 'msg static_node -> 'msg node
   | Empty : 'msg node
 
-let rec map_msg f node =
-  match node with
-  | View
+(* A hoisted subtree that is built, laid out and converted to primitives
+   once. It is laid out again only when the size it gets changes; when it
+   moves, the cached results are translated. [pinned_width] and
+   [pinned_height] fix the size of its box when given. *)
+and 'msg static_node = {
+  pinned_width : int option;
+  pinned_height : int option;
+  build : unit -> 'msg node;
+  mutable content : 'msg node option;
+  mutable laid_out : 'msg static_layout option;
+  mutable placed_primitives : (float * float * primitive_buffer) option;
+}
+
+(* Layout of a static subtree at the origin *)
+and 'msg static_layout = {
+  size : float * float;
+  tree : 'msg bounds_tree;
+  primitives : primitive_buffer;
+}
+
+(* The laid-out node tree in structure-of-arrays form. Entry [i] is a node
+   with its bounds, its parent, first child and next sibling ([-1] for none)
+   and its position among its siblings. Entries are in depth-first order, so
+   a subtree is a contiguous range. The arrays are reused from frame to frame
+   and only grow; [generation] changes whenever the tree is cleared. *)
+and 'msg bounds_tree = {
+  mutable length : int;
+  mutable generation : int;
+  mutable xs : Float.Array.t;
+  mutable ys : Float.Array.t;
+  mutable widths : Float.Array.t;
+  mutable heights : Float.Array.t;
+  mutable parents : int array;
+  mutable first_children : int array;
+  mutable next_siblings : int array;
+  mutable indices : int array;
+  mutable nodes : 'msg node array;
+}
+
+let check_size name = function
+  | Some size when size <= 0 ->
+      invalid_arg (name ^ ": width and height must be positive")
+  | _ ->
+      ()
+
+let static ?width ?height build =
+  check_size "static" width;
+  check_size "static" height;
+  Static
+    {
+      pinned_width = width;
+      pinned_height = height;
+      build;
+      content = None;
+      laid_out = None;
+      placed_primitives = None;
+    }
+
+let static_content static =
+  match static.content with
+  | Some content ->
+      content
+  | None ->
+      let content = static.build () in
+      static.content <- Some content;
+      content
+
+(* Clock of throttled subtrees, installed by the runtime: [now] is the time
+   in milliseconds, and [refresh_at at] asks for every window to be redrawn
+   at [at], so a subtree still showing an older input catches up even if
+   nothing else changes. *)
+type throttle_clock = {
+  mutable now : unit -> int;
+  mutable refresh_at : int -> unit;
+}
+
+let throttle_clock = { now = (fun () -> 0); refresh_at = ignore }
+
+(* Each refresh makes a new static, so between refreshes layout gets the
+   same node and reuses its bounds and primitives, charts included *)
+let throttled ~fps ?width ?height build =
+  if not (fps > 0.0) then invalid_arg "throttled: fps must be positive";
+  check_size "throttled" width;
+  check_size "throttled" height;
+  let interval = int_of_float (Float.ceil (1000.0 /. fps)) in
+  let current = ref None in
+  fun input ->
+    let now = throttle_clock.now () in
+    match !current with
+    | Some (built_from, node, _) when built_from == input ->
+        node
+    | Some (_, node, built_at) when now < built_at + interval ->
+        throttle_clock.refresh_at (built_at + interval);
+        node
+    | _ ->
+        let node = static ?width ?height (fun () -> build input) in
+        current := Some (input, node, now);
+        node
+
+let map_handlers f handlers =
+  match handlers with
+  | Handlers
       {
-        style;
-        children;
-        key;
-        on_click;
-        on_mouse_down;
-        on_mouse_up;
-        on_mouse_move;
-        on_mouse_enter;
-        on_mouse_leave;
+        on_click = No_click;
+        on_mouse_down = No_pointer;
+        on_mouse_up = No_pointer;
+        on_mouse_move = No_pointer;
+        on_mouse_enter = No_pointer;
+        on_mouse_leave = No_pointer;
       } ->
+      no_handlers
+  | handlers ->
+      Mapped (f, handlers)
+
+let rec map_msg f node =
+  match node with
+  | View { style; children; key; handlers } ->
       View
         {
           style;
-          children = List.map (map_msg f) children;
-          key;
-          on_click =
-            Option.map (fun handler () -> Option.map f (handler ())) on_click;
-          on_mouse_down =
-            Option.map
-              (fun handler pos -> Option.map f (handler pos))
-              on_mouse_down;
-          on_mouse_up =
-            Option.map
-              (fun handler pos -> Option.map f (handler pos))
-              on_mouse_up;
-          on_mouse_move =
-            Option.map
-              (fun handler pos -> Option.map f (handler pos))
-              on_mouse_move;
-          on_mouse_enter =
-            Option.map
-              (fun handler pos -> Option.map f (handler pos))
-              on_mouse_enter;
-          on_mouse_leave =
-            Option.map
-              (fun handler pos -> Option.map f (handler pos))
-              on_mouse_leave;
-        }
-  | Text { content; style; key; on_click } ->
-      Text
-        {
-          content;
-          style;
-          key;
-          on_click =
-            Option.map (fun handler () -> Option.map f (handler ())) on_click;
-        }
-  | Canvas
-      {
-        primitives;
-        style;
-        key;
-        on_click;
-        on_mouse_down;
-        on_mouse_up;
-        on_mouse_move;
-        on_mouse_enter;
-        on_mouse_leave;
-      } ->
-      Canvas
-        {
-          primitives;
-          style;
+          children = Array.map (map_msg f) children;
           key;
-          on_click =
-            Option.map (fun handler () -> Option.map f (handler ())) on_click;
-          on_mouse_down =
-            Option.map
-              (fun handler pos -> Option.map f (handler pos))
-              on_mouse_down;
-          on_mouse_up =
-            Option.map
-              (fun handler pos -> Option.map f (handler pos))
-              on_mouse_up;
-          on_mouse_move =
-            Option.map
-              (fun handler pos -> Option.map f (handler pos))
-              on_mouse_move;
-          on_mouse_enter =
-            Option.map
-              (fun handler pos -> Option.map f (handler pos))
-              on_mouse_enter;
-          on_mouse_leave =
-            Option.map
-              (fun handler pos -> Option.map f (handler pos))
-              on_mouse_leave;
+          handlers = map_handlers f handlers;
         }
+  | Text { content; style; key; handlers } ->
+      Text { content; style; key; handlers = map_handlers f handlers }
+  | Canvas { primitives; style; key; handlers } ->
+      Canvas { primitives; style; key; handlers = map_handlers f handlers }
+  | Chart { series; style; key; color; line_width; y_range } ->
+      Chart { series; style; key; color; line_width; y_range }
+  | Raster { raster; style; key; handlers } ->
+      Raster { raster; style; key; handlers = map_handlers f handlers }
+  | Editor { editor; style; key; handlers } ->
+      Editor { editor; style; key; handlers = map_handlers f handlers }
+  | Static static_node ->
+      (* Mapped statics keep their own cache; map before hoisting to share *)
+      static ?width:static_node.pinned_width ?height:static_node.pinned_height
+        (fun () -> map_msg f (static_content static_node))
   | Empty ->
       Empty
 
 type 'msg interactive_node = 'msg node
 
-type path = int list
+(* The closure form of a handler wins over the message form, and the message
+   form over the payload form *)
+let click_handler handler msg with_payload =
+  match (handler, msg, with_payload) with
+  | Some handler, _, _ ->
+      Click handler
+  | None, Some msg, _ ->
+      Click_msg msg
+  | None, None, Some (handler, payload) ->
+      Click_with (handler, payload)
+  | None, None, None ->
+      No_click
 
-type 'msg node_with_bounds = {
-  node : 'msg interactive_node;
-  bounds : bounds;
-  children : 'msg node_with_bounds list;
-  path : path;
-}
+let pointer_handler handler msg with_payload =
+  match (handler, msg, with_payload) with
+  | Some handler, _, _ ->
+      Pointer handler
+  | None, Some msg, _ ->
+      Pointer_msg msg
+  | None, None, Some (handler, payload) ->
+      Pointer_with (handler, payload)
+  | None, None, None ->
+      No_pointer
 
-let view ?(style = Style.default) ?key ?on_click ?on_mouse_down ?on_mouse_up
-    ?on_mouse_move ?on_mouse_enter ?on_mouse_leave children =
-  View
-    {
-      style;
-      children;
-      key;
-      on_click;
-      on_mouse_down;
-      on_mouse_up;
-      on_mouse_move;
-      on_mouse_enter;
-      on_mouse_leave;
-    }
+let make_handlers ?on_click ?on_click_msg ?on_click_with ?on_mouse_down
+    ?on_mouse_down_msg ?on_mouse_down_with ?on_mouse_up ?on_mouse_up_msg
+    ?on_mouse_up_with ?on_mouse_move ?on_mouse_move_msg ?on_mouse_move_with
+    ?on_mouse_enter ?on_mouse_enter_msg ?on_mouse_enter_with ?on_mouse_leave
+    ?on_mouse_leave_msg ?on_mouse_leave_with () =
+  match
+    ( click_handler on_click on_click_msg on_click_with,
+      pointer_handler on_mouse_down on_mouse_down_msg on_mouse_down_with,
+      pointer_handler on_mouse_up on_mouse_up_msg on_mouse_up_with,
+      pointer_handler on_mouse_move on_mouse_move_msg on_mouse_move_with,
+      pointer_handler on_mouse_enter on_mouse_enter_msg on_mouse_enter_with,
+      pointer_handler on_mouse_leave on_mouse_leave_msg on_mouse_leave_with )
+  with
+  | No_click, No_pointer, No_pointer, No_pointer, No_pointer, No_pointer ->
+      no_handlers
+  | ( on_click,
+      on_mouse_down,
+      on_mouse_up,
+      on_mouse_move,
+      on_mouse_enter,
+      on_mouse_leave ) ->
+      Handlers
+        {
+          on_click;
+          on_mouse_down;
+          on_mouse_up;
+          on_mouse_move;
+          on_mouse_enter;
+          on_mouse_leave;
+        }
 
-let text ?(style = Style.default) ?key ?on_click content =
-  Text { content; style; key; on_click }
+let view_array ?(style = Style.default) ?key ?on_click ?on_click_msg
+    ?on_click_with ?on_mouse_down ?on_mouse_down_msg ?on_mouse_down_with
+    ?on_mouse_up ?on_mouse_up_msg ?on_mouse_up_with ?on_mouse_move
+    ?on_mouse_move_msg ?on_mouse_move_with ?on_mouse_enter ?on_mouse_enter_msg
+    ?on_mouse_enter_with ?on_mouse_leave ?on_mouse_leave_msg
+    ?on_mouse_leave_with children =
+  let handlers =
+    make_handlers ?on_click ?on_click_msg ?on_click_with ?on_mouse_down
+      ?on_mouse_down_msg ?on_mouse_down_with ?on_mouse_up ?on_mouse_up_msg
+      ?on_mouse_up_with ?on_mouse_move ?on_mouse_move_msg ?on_mouse_move_with
+      ?on_mouse_enter ?on_mouse_enter_msg ?on_mouse_enter_with ?on_mouse_leave
+      ?on_mouse_leave_msg ?on_mouse_leave_with ()
+  in
+  View { style; children; key; handlers }
 
-let canvas ?(style = Style.default) ?key ?on_click ?on_mouse_down ?on_mouse_up
-    ?on_mouse_move ?on_mouse_enter ?on_mouse_leave primitives =
-  Canvas
-    {
-      primitives;
-      style;
-      key;
-      on_click;
-      on_mouse_down;
-      on_mouse_up;
-      on_mouse_move;
-      on_mouse_enter;
-      on_mouse_leave;
-    }
+let view ?style ?key ?on_click ?on_click_msg ?on_click_with ?on_mouse_down
+    ?on_mouse_down_msg ?on_mouse_down_with ?on_mouse_up ?on_mouse_up_msg
+    ?on_mouse_up_with ?on_mouse_move ?on_mouse_move_msg ?on_mouse_move_with
+    ?on_mouse_enter ?on_mouse_enter_msg ?on_mouse_enter_with ?on_mouse_leave
+    ?on_mouse_leave_msg ?on_mouse_leave_with children =
+  view_array ?style ?key ?on_click ?on_click_msg ?on_click_with ?on_mouse_down
+    ?on_mouse_down_msg ?on_mouse_down_with ?on_mouse_up ?on_mouse_up_msg
+    ?on_mouse_up_with ?on_mouse_move ?on_mouse_move_msg ?on_mouse_move_with
+    ?on_mouse_enter ?on_mouse_enter_msg ?on_mouse_enter_with ?on_mouse_leave
+    ?on_mouse_leave_msg ?on_mouse_leave_with (Array.of_list children)
+
+let text ?(style = Style.default) ?key ?on_click ?on_click_msg ?on_click_with
+    content =
+  let handlers = make_handlers ?on_click ?on_click_msg ?on_click_with () in
+  Text { content; style; key; handlers }
+
+let canvas ?(style = Style.default) ?key ?on_click ?on_click_msg ?on_click_with
+    ?on_mouse_down ?on_mouse_down_msg ?on_mouse_down_with ?on_mouse_up
+    ?on_mouse_up_msg ?on_mouse_up_with ?on_mouse_move ?on_mouse_move_msg
+    ?on_mouse_move_with ?on_mouse_enter ?on_mouse_enter_msg ?on_mouse_enter_with
+    ?on_mouse_leave ?on_mouse_leave_msg ?on_mouse_leave_with primitives =
+  let handlers =
+    make_handlers ?on_click ?on_click_msg ?on_click_with ?on_mouse_down
+      ?on_mouse_down_msg ?on_mouse_down_with ?on_mouse_up ?on_mouse_up_msg
+      ?on_mouse_up_with ?on_mouse_move ?on_mouse_move_msg ?on_mouse_move_with
+      ?on_mouse_enter ?on_mouse_enter_msg ?on_mouse_enter_with ?on_mouse_leave
+      ?on_mouse_leave_msg ?on_mouse_leave_with ()
+  in
+  Canvas { primitives; style; key; handlers }
+
+let chart ?(style = Style.default) ?key
+    ?(color = Color.make ~r:0 ~g:0 ~b:0 ()) ?(line_width = 1.0) ?y_range
+    series =
+  Chart { series; style; key; color; line_width; y_range }
+
+let raster ?(style = Style.default) ?key ?on_click ?on_click_msg ?on_click_with
+    ?on_mouse_down ?on_mouse_down_msg ?on_mouse_down_with ?on_mouse_up
+    ?on_mouse_up_msg ?on_mouse_up_with ?on_mouse_move ?on_mouse_move_msg
+    ?on_mouse_move_with ?on_mouse_enter ?on_mouse_enter_msg ?on_mouse_enter_with
+    ?on_mouse_leave ?on_mouse_leave_msg ?on_mouse_leave_with raster =
+  let handlers =
+    make_handlers ?on_click ?on_click_msg ?on_click_with ?on_mouse_down
+      ?on_mouse_down_msg ?on_mouse_down_with ?on_mouse_up ?on_mouse_up_msg
+      ?on_mouse_up_with ?on_mouse_move ?on_mouse_move_msg ?on_mouse_move_with
+      ?on_mouse_enter ?on_mouse_enter_msg ?on_mouse_enter_with ?on_mouse_leave
+      ?on_mouse_leave_msg ?on_mouse_leave_with ()
+  in
+  Raster { raster; style; key; handlers }
+
+let editor ?(style = Style.default) ?key ?on_click ?on_click_msg ?on_click_with
+    ?on_mouse_down ?on_mouse_down_msg ?on_mouse_down_with ?on_mouse_up
+    ?on_mouse_up_msg ?on_mouse_up_with ?on_mouse_move ?on_mouse_move_msg
+    ?on_mouse_move_with ?on_mouse_enter ?on_mouse_enter_msg ?on_mouse_enter_with
+    ?on_mouse_leave ?on_mouse_leave_msg ?on_mouse_leave_with editor =
+  let handlers =
+    make_handlers ?on_click ?on_click_msg ?on_click_with ?on_mouse_down
+      ?on_mouse_down_msg ?on_mouse_down_with ?on_mouse_up ?on_mouse_up_msg
+      ?on_mouse_up_with ?on_mouse_move ?on_mouse_move_msg ?on_mouse_move_with
+      ?on_mouse_enter ?on_mouse_enter_msg ?on_mouse_enter_with ?on_mouse_leave
+      ?on_mouse_leave_msg ?on_mouse_leave_with ()
+  in
+  Editor { editor; style; key; handlers }
 
 let empty = Empty
 
@@ -0,0 +1,35 @@
+type job = {
+  name : string;
+  run : time_left:(unit -> float) -> [ `Done | `More ];
+}
+
+let jobs : job Queue.t = Queue.create ()
+
+let schedule ?(name = "idle job") run =
+  Queue.push { name; run } jobs;
+  Wakeup.wake ()
+
+let pending_names () =
+  List.rev (Queue.fold (fun names job -> job.name :: names) [] jobs)
+
+let pending () = not (Queue.is_empty jobs)
+
+(* Jobs scheduled while running wait for the next frame, as do the ones
+   after a job that used up the slack *)
+let run ~now ~deadline =
+  let time_left () = deadline -. now () in
+  let rec run_next left =
+    if left > 0 && time_left () > 0.0 then
+      match Queue.take_opt jobs with
+      | Some job ->
+          (match job.run ~time_left with
+          | `More ->
+              Queue.push job jobs
+          | `Done ->
+              ());
+          run_next (left - 1)
+      | None ->
+          ()
+  in
+  run_next (Queue.length jobs);
+  pending ()
@@ -0,0 +1,48 @@
+(** Low-priority jobs run in the slack at the end of a frame.
+
+    Once a frame has handled its input and messages, rendered, and given
+    {!Task}s their turn, what is left until the next frame is due goes to
+    idle jobs: cache pruning, measuring text ahead of time, warming up
+    anything a later frame will want. Idle jobs get nothing while the loop
+    is short of time, and all of the frame while the app has nothing else
+    to do.
+
+    Each job is called with the time left and returns whether it has more to
+    do, in which case it is called again in a later frame. Jobs should check
+    the time left as they go and stop before it runs out; the runtime cannot
+    stop them. Main loop only. *)
+
+val schedule :
+  ?name:string -> (time_left:(unit -> float) -> [ `Done | `More ]) -> unit
+(** [schedule job] calls [job ~time_left] in the slack of a frame, from the
+    current frame on, in the order jobs were scheduled. [time_left ()] is the
+    number of milliseconds until the frame's slack runs out. A job that
+    returns [`More] is called again in a later frame, after the other
+    waiting jobs. [name] shows up in {!pending_names}.
+
+    Example:
+    {[
+      let next_line = ref 0
+
+      let measure_lines ~time_left =
+        while !next_line < Array.length lines && time_left () > 0.5 do
+          widths.(!next_line) <- measure lines.(!next_line);
+          incr next_line
+        done;
+        if !next_line < Array.length lines then `More else `Done
+
+      let () = Idle.schedule ~name:"measure lines" measure_lines
+    ]} *)
+
+val pending_names : unit -> string list
+(** Names of the jobs waiting to run, in order, for debugging *)
+
+(** {2 Internal API for the Runtime} *)
+
+val pending : unit -> bool
+(** Whether any job is waiting to run *)
+
+val run : now:(unit -> float) -> deadline:float -> bool
+(** [run ~now ~deadline] calls each waiting job at most once, in order, until
+    [now ()] reaches [deadline], with [now] as the clock in milliseconds.
+    Returns whether any job is still waiting. *)
@@ -0,0 +1,12 @@
+type 'msg t = 'msg Mpsc_queue.t
+
+let create ?(capacity = 4096) () = Mpsc_queue.create ~capacity
+
+let post t msg =
+  let posted = Mpsc_queue.push t msg in
+  if posted then Wakeup.wake ();
+  posted
+
+let pop = Mpsc_queue.pop
+
+let is_empty = Mpsc_queue.is_empty
@@ -0,0 +1,42 @@
+(** Messages for [update] from other domains and threads.
+
+    An inbox is a bounded queue that any domain or thread may post to. The
+    app subscribes to it with {!Mlui.Sub.on_inbox}, and the runtime hands its
+    messages to [update] on the main loop, in the order they were posted.
+
+    Inbox messages are background work. Each frame, pending input is handled
+    first; inbox messages then get a bounded slice of the frame, and the rest
+    wait for the next one. A flood of posts, such as a telemetry feed, slows
+    its own delivery, not the app's response to clicks and keys. *)
+
+type 'msg t
+
+val create : ?capacity:int -> unit -> 'msg t
+(** [create ()] is an empty inbox holding up to [capacity] (default [4096],
+    rounded up to a power of two) messages not yet handled. *)
+
+val post : 'msg t -> 'msg -> bool
+(** [post t msg] queues [msg] and wakes the event loop. Returns [false], and
+    drops [msg], when [t] is full. Safe to call from any domain.
+
+    Example:
+    {[
+      let feed = Inbox.create ()
+
+      let _ =
+        Domain.spawn (fun () ->
+            while true do
+              let sample = read_sensor () in
+              ignore (Inbox.post feed (Msg.Sample sample))
+            done)
+
+      let subscriptions _model = Sub.on_inbox feed
+    ]} *)
+
+(** {2 Internal API for the Runtime} *)
+
+val pop : 'msg t -> 'msg option
+(** Main loop only *)
+
+val is_empty : 'msg t -> bool
+(** Main loop only *)
@@ -0,0 +1,88 @@
+(* Incremental values are pull-based. Each one remembers the model it was
+   last brought up to date for, the revision at which its value last
+   changed, and the revision at which it was last checked; it is recomputed
+   when an input changed after that. *)
+
+type ('model, 'a) t = {
+  compute : ('model, 'a) compute;
+  equal : 'a -> 'a -> bool;
+  mutable value : 'a option;
+  mutable seen : 'model option;
+  mutable changed_at : int;
+  mutable verified_at : int;
+}
+
+and ('model, 'a) compute =
+  | Field : ('model -> 'a) -> ('model, 'a) compute
+  | Derived : 'model input list * (unit -> 'a) -> ('model, 'a) compute
+
+and 'model input = Input : ('model, 'a) t -> 'model input
+
+(* Bumped whenever any value changes *)
+let revision = ref 0
+
+let make ?(equal = ( == )) compute =
+  {
+    compute;
+    equal;
+    value = None;
+    seen = None;
+    changed_at = 0;
+    verified_at = -1;
+  }
+
+let field ?equal get = make ?equal (Field get)
+
+let current t =
+  match t.value with
+  | Some value ->
+      value
+  | None ->
+      invalid_arg "Incr: value read before it was computed"
+
+let set t value =
+  match t.value with
+  | Some previous when t.equal previous value ->
+      ()
+  | _ ->
+      incr revision;
+      t.value <- Some value;
+      t.changed_at <- !revision
+
+let rec update : type model a. (model, a) t -> model -> unit =
+ fun t model ->
+  match t.seen with
+  | Some seen when seen == model ->
+      ()
+  | _ ->
+      (match t.compute with
+      | Field get ->
+          set t (get model)
+      | Derived (inputs, compute) ->
+          List.iter (function Input input -> update input model) inputs;
+          if
+            Option.is_none t.value
+            || List.exists
+                 (function Input input -> input.changed_at > t.verified_at)
+                 inputs
+          then
+            set t (compute ()));
+      t.verified_at <- !revision;
+      t.seen <- Some model
+
+let map ?equal t ~f =
+  make ?equal (Derived ([ Input t ], fun () -> f (current t)))
+
+let map2 ?equal a b ~f =
+  make ?equal
+    (Derived ([ Input a; Input b ], fun () -> f (current a) (current b)))
+
+let map3 ?equal a b c ~f =
+  make ?equal
+    (Derived
+       ( [ Input a; Input b; Input c ],
+         fun () -> f (current a) (current b) (current c) ))
+
+let read t model =
+  update t model;
+  current t
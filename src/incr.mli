@@ -0,0 +1,77 @@
+(** Incremental computations of data derived from the model.
+
+    [view] is a plain function of the model, so anything it derives (sorted
+    rows, filtered sets, aggregates) is computed again on every frame. An
+    incremental value is defined once, outside of [view], from model fields
+    and other incremental values, and {!read} in [view]. It is recomputed only
+    when one of its inputs changed since it was last read, and when the
+    result is equal to the previous one, what depends on it is not recomputed
+    either.
+
+    Values are brought up to date when read, for the model they are read
+    with. Reading against the same model again is free, so a graph is visited
+    at most once per model whatever is read from it.
+
+    An incremental value that is a node memoizes a subtree: while its inputs
+    are unchanged, {!read} returns the same node, and layout reuses the
+    subtree with its layout and primitives from the previous frame.
+
+    Example:
+    {[
+      let rows = Incr.field (fun model -> model.rows)
+      let filter = Incr.field (fun model -> model.filter)
+
+      let visible =
+        Incr.map2 rows filter ~f:(fun rows filter ->
+            List.filter (matches filter) rows)
+
+      let total =
+        Incr.map ~equal:Float.equal visible ~f:(fun rows ->
+            List.fold_left (fun sum row -> sum +. row.amount) 0.0 rows)
+
+      let total_label =
+        Incr.map total ~f:(fun total -> text (Printf.sprintf "%.2f" total))
+
+      let view model =
+        view
+          [ table (Incr.read visible model); Incr.read total_label model ]
+    ]}
+
+    Incremental values keep the last model they were read with alive. They
+    are not thread-safe; read them from [view] or [update]. *)
+
+type ('model, 'a) t
+(** A value of type ['a] derived from a model of type ['model] *)
+
+val field : ?equal:('a -> 'a -> bool) -> ('model -> 'a) -> ('model, 'a) t
+(** [field get] is the part of the model selected by [get], which should be
+    cheap, such as reading a record field. It counts as changed when it is
+    not [equal] to the previous one, by default when it is not physically
+    equal. *)
+
+val map :
+  ?equal:('b -> 'b -> bool) -> ('model, 'a) t -> f:('a -> 'b) -> ('model, 'b) t
+(** [map t ~f] is [f] applied to [t], recomputed when [t] changes. Its result
+    counts as changed when it is not [equal] to the previous one, by default
+    when it is not physically equal; pass a structural [equal] to stop
+    propagation when a recomputed value is the same. *)
+
+val map2 :
+  ?equal:('c -> 'c -> bool) ->
+  ('model, 'a) t ->
+  ('model, 'b) t ->
+  f:('a -> 'b -> 'c) ->
+  ('model, 'c) t
+(** Like {!map}, recomputed when either input changes *)
+
+val map3 :
+  ?equal:('d -> 'd -> bool) ->
+  ('model, 'a) t ->
+  ('model, 'b) t ->
+  ('model, 'c) t ->
+  f:('a -> 'b -> 'c -> 'd) ->
+  ('model, 'd) t
+(** Like {!map}, recomputed when any input changes *)
+
+val read : ('model, 'a) t -> 'model -> 'a
+(** [read t model] brings [t] up to date for [model] and returns it *)
@@ -8,6 +8,17 @@ module Cmd = Cmd
 module Sub = Subscription
 module Tray = Tray
 module Animation = Animation
+module Quality = Quality
+module Wakeup = Wakeup
+module Incr = Incr
+module Series = Series
+module Raster = Raster
+module Text_buffer = Text_buffer
+module Text_editor = Text_editor
+module Stats = Stats
+module Inbox = Inbox
+module Task = Task
+module Idle = Idle
 module Cocoa = Cocoa_hello
 
 (* Re-export types *)
@@ -37,9 +48,15 @@ type primitive = Ui.primitive =
 
 (* Re-export UI construction functions *)
 let view = Ui.view
+let view_array = Ui.view_array
 let text = Ui.text
 let canvas = Ui.canvas
+let chart = Ui.chart
+let raster = Ui.raster
+let editor = Ui.editor
 let empty = Ui.empty
+let static = Ui.static
+let throttled = Ui.throttled
 let map_msg = Ui.map_msg
 
 (* Operator for map_msg - lifting messages *)
@@ -56,5 +73,12 @@ let stroke = Ui.stroke
 let fill_and_stroke = Ui.fill_and_stroke
 
 (* Main run function *)
-let run ~window ?subscriptions ~init ~update ~view () =
-  Ui.run ~window ?subscriptions ~init ~update ~view ()
+let run ~window ?subscriptions ?quality ?msg_name ?slow_update_ms
+    ?model_sample_ms ~init ~update ~view () =
+  Ui.run ~window ?subscriptions ?quality ?msg_name ?slow_update_ms
+    ?model_sample_ms ~init ~update ~view ()
+
+let run_windows ~windows ?subscriptions ?quality ?msg_name ?slow_update_ms
+    ?model_sample_ms ~init ~update () =
+  Ui.run_windows ~windows ?subscriptions ?quality ?msg_name ?slow_update_ms
+    ?model_sample_ms ~init ~update ()
@@ -9,6 +9,17 @@ module Cmd = Cmd
 module Sub = Subscription
 module Tray = Tray
 module Animation = Animation
+module Quality = Quality
+module Wakeup = Wakeup
+module Incr = Incr
+module Series = Series
+module Raster = Raster
+module Text_buffer = Text_buffer
+module Text_editor = Text_editor
+module Stats = Stats
+module Inbox = Inbox
+module Task = Task
+module Idle = Idle
 module Cocoa = Cocoa_hello
 
 (** {1 UI Construction} *)
@@ -45,18 +56,85 @@ val view :
   ?style:Style.t ->
   ?key:string ->
   ?on_click:(unit -> 'msg option) ->
+  ?on_click_msg:'msg ->
+  ?on_click_with:('a -> 'msg option) * 'a ->
   ?on_mouse_down:(int * int -> 'msg option) ->
+  ?on_mouse_down_msg:'msg ->
+  ?on_mouse_down_with:('b -> int * int -> 'msg option) * 'b ->
   ?on_mouse_up:(int * int -> 'msg option) ->
+  ?on_mouse_up_msg:'msg ->
+  ?on_mouse_up_with:('c -> int * int -> 'msg option) * 'c ->
   ?on_mouse_move:(int * int -> 'msg option) ->
+  ?on_mouse_move_msg:'msg ->
+  ?on_mouse_move_with:('d -> int * int -> 'msg option) * 'd ->
   ?on_mouse_enter:(int * int -> 'msg option) ->
+  ?on_mouse_enter_msg:'msg ->
+  ?on_mouse_enter_with:('e -> int * int -> 'msg option) * 'e ->
   ?on_mouse_leave:(int * int -> 'msg option) ->
+  ?on_mouse_leave_msg:'msg ->
+  ?on_mouse_leave_with:('f -> int * int -> 'msg option) * 'f ->
   'msg node list ->
   'msg node
+(** [view children] is a flex container. Handlers get the pointer position
+    relative to the node. Besides a closure, every handler takes two forms
+    that allocate no closure when the view is rebuilt every frame, which adds
+    up in large interactive grids: [on_*_msg], the message to send, and
+    [on_*_with], a function and the payload to pass it. Define that function
+    once, at top level. When several forms are given for one event, the
+    closure is used first, then the message.
+
+    Example:
+    {[
+      let select_cell (row, col) _position = Some (Msg.Select (row, col))
+      let hover_cell (row, col) _position = Some (Msg.Hover (row, col))
+
+      view ~on_click_msg:Msg.Increment [ text "+" ];
+      view
+        ~on_mouse_down_with:(select_cell, (row, col))
+        ~on_mouse_enter_with:(hover_cell, (row, col))
+        [ cell_label ]
+    ]} *)
+
+val view_array :
+  ?style:Style.t ->
+  ?key:string ->
+  ?on_click:(unit -> 'msg option) ->
+  ?on_click_msg:'msg ->
+  ?on_click_with:('a -> 'msg option) * 'a ->
+  ?on_mouse_down:(int * int -> 'msg option) ->
+  ?on_mouse_down_msg:'msg ->
+  ?on_mouse_down_with:('b -> int * int -> 'msg option) * 'b ->
+  ?on_mouse_up:(int * int -> 'msg option) ->
+  ?on_mouse_up_msg:'msg ->
+  ?on_mouse_up_with:('c -> int * int -> 'msg option) * 'c ->
+  ?on_mouse_move:(int * int -> 'msg option) ->
+  ?on_mouse_move_msg:'msg ->
+  ?on_mouse_move_with:('d -> int * int -> 'msg option) * 'd ->
+  ?on_mouse_enter:(int * int -> 'msg option) ->
+  ?on_mouse_enter_msg:'msg ->
+  ?on_mouse_enter_with:('e -> int * int -> 'msg option) * 'e ->
+  ?on_mouse_leave:(int * int -> 'msg option) ->
+  ?on_mouse_leave_msg:'msg ->
+  ?on_mouse_leave_with:('f -> int * int -> 'msg option) * 'f ->
+  'msg node array ->
+  'msg node
+(** Like {!view}, with the children in an array, which is used as is. Prefer it
+    for wide containers built from arrays, such as rows of a large table: the
+    children are not copied, and layout indexes into them directly. Do not
+    mutate the array afterwards.
+
+    Example:
+    {[
+      view_array ~style:Styles.table
+        (Array.map (fun row -> table_row row) model.rows)
+    ]} *)
 
 val text :
   ?style:Style.t ->
   ?key:string ->
   ?on_click:(unit -> 'msg option) ->
+  ?on_click_msg:'msg ->
+  ?on_click_with:('a -> 'msg option) * 'a ->
   string ->
   'msg node
 
@@ -64,16 +142,225 @@ val canvas :
   ?style:Style.t ->
   ?key:string ->
   ?on_click:(unit -> 'msg option) ->
+  ?on_click_msg:'msg ->
+  ?on_click_with:('a -> 'msg option) * 'a ->
   ?on_mouse_down:(int * int -> 'msg option) ->
+  ?on_mouse_down_msg:'msg ->
+  ?on_mouse_down_with:('b -> int * int -> 'msg option) * 'b ->
   ?on_mouse_up:(int * int -> 'msg option) ->
+  ?on_mouse_up_msg:'msg ->
+  ?on_mouse_up_with:('c -> int * int -> 'msg option) * 'c ->
   ?on_mouse_move:(int * int -> 'msg option) ->
+  ?on_mouse_move_msg:'msg ->
+  ?on_mouse_move_with:('d -> int * int -> 'msg option) * 'd ->
   ?on_mouse_enter:(int * int -> 'msg option) ->
+  ?on_mouse_enter_msg:'msg ->
+  ?on_mouse_enter_with:('e -> int * int -> 'msg option) * 'e ->
   ?on_mouse_leave:(int * int -> 'msg option) ->
+  ?on_mouse_leave_msg:'msg ->
+  ?on_mouse_leave_with:('f -> int * int -> 'msg option) * 'f ->
   primitive list ->
   'msg node
 
+val chart :
+  ?style:Style.t ->
+  ?key:string ->
+  ?color:Color.t ->
+  ?line_width:float ->
+  ?y_range:float * float ->
+  Series.t ->
+  'msg node
+(** [chart series] draws [series] as a line across its box, which needs a
+    size from its style or from flex. The line is [line_width] wide and spans
+    [y_range] vertically, by default the range of the samples.
+
+    Millions of samples are fine: the series is decimated to at most four
+    points per column of the box when drawn, and samples pushed since are
+    folded into that on the next frame. Pushing to the series redraws the
+    window showing the chart even when the model is unchanged, except inside
+    {!static} and {!throttled}, which refresh on their own terms.
+
+    Example:
+    {[
+      let latency = Series.create ~capacity:1_000_000
+
+      let update msg model =
+        match msg with
+        | Msg.Sample (time, ms) ->
+            Series.push latency ~x:time ~y:ms;
+            (model, Cmd.none)
+
+      let view _model =
+        chart ~style:Styles.plot ~color:Colors.accent ~y_range:(0.0, 100.0)
+          latency
+    ]} *)
+
+val raster :
+  ?style:Style.t ->
+  ?key:string ->
+  ?on_click:(unit -> 'msg option) ->
+  ?on_click_msg:'msg ->
+  ?on_click_with:('a -> 'msg option) * 'a ->
+  ?on_mouse_down:(int * int -> 'msg option) ->
+  ?on_mouse_down_msg:'msg ->
+  ?on_mouse_down_with:('b -> int * int -> 'msg option) * 'b ->
+  ?on_mouse_up:(int * int -> 'msg option) ->
+  ?on_mouse_up_msg:'msg ->
+  ?on_mouse_up_with:('c -> int * int -> 'msg option) * 'c ->
+  ?on_mouse_move:(int * int -> 'msg option) ->
+  ?on_mouse_move_msg:'msg ->
+  ?on_mouse_move_with:('d -> int * int -> 'msg option) * 'd ->
+  ?on_mouse_enter:(int * int -> 'msg option) ->
+  ?on_mouse_enter_msg:'msg ->
+  ?on_mouse_enter_with:('e -> int * int -> 'msg option) * 'e ->
+  ?on_mouse_leave:(int * int -> 'msg option) ->
+  ?on_mouse_leave_msg:'msg ->
+  ?on_mouse_leave_with:('f -> int * int -> 'msg option) * 'f ->
+  Raster.t ->
+  'msg node
+(** [raster r] draws [r] stretched over its box, which needs a size from its
+    style or from flex, as a single textured quad with nearest filtering.
+    Pointer positions given to handlers are relative to the box, not to the
+    pixels of [r].
+
+    Use it for heatmaps, spectrograms and images that would take thousands of
+    canvas primitives. The pixels are uploaded when the raster is first
+    drawn; after that, each frame uploads only the rows changed since the
+    last one, so a live heatmap updating a few rows costs a few kilobytes per
+    frame. Changing the raster redraws the window showing it even when the
+    model is unchanged, including inside {!static}.
+
+    Example:
+    {[
+      let heat =
+        Raster.scalar ~range:(0.0, 100.0) ~colormap:Colors.inferno
+          ~width:1000 ~height:1000 ()
+
+      let update msg model =
+        match msg with
+        | Msg.Row (y, readings) ->
+            Array.iteri (fun x value -> Raster.set heat ~x ~y value) readings;
+            ({ model with rows = model.rows + 1 }, Cmd.none)
+
+      let view _model = raster ~style:Styles.heatmap heat
+    ]} *)
+
+val editor :
+  ?style:Style.t ->
+  ?key:string ->
+  ?on_click:(unit -> 'msg option) ->
+  ?on_click_msg:'msg ->
+  ?on_click_with:('a -> 'msg option) * 'a ->
+  ?on_mouse_down:(int * int -> 'msg option) ->
+  ?on_mouse_down_msg:'msg ->
+  ?on_mouse_down_with:('b -> int * int -> 'msg option) * 'b ->
+  ?on_mouse_up:(int * int -> 'msg option) ->
+  ?on_mouse_up_msg:'msg ->
+  ?on_mouse_up_with:('c -> int * int -> 'msg option) * 'c ->
+  ?on_mouse_move:(int * int -> 'msg option) ->
+  ?on_mouse_move_msg:'msg ->
+  ?on_mouse_move_with:('d -> int * int -> 'msg option) * 'd ->
+  ?on_mouse_enter:(int * int -> 'msg option) ->
+  ?on_mouse_enter_msg:'msg ->
+  ?on_mouse_enter_with:('e -> int * int -> 'msg option) * 'e ->
+  ?on_mouse_leave:(int * int -> 'msg option) ->
+  ?on_mouse_leave_msg:'msg ->
+  ?on_mouse_leave_with:('f -> int * int -> 'msg option) * 'f ->
+  Text_editor.t ->
+  'msg node
+(** [editor e] shows the text of [e] from its first line down, left aligned
+    with its style's [font_size] and [text_color], with a caret at the cursor.
+    Only the lines that fit its box are read from the buffer and drawn, so
+    documents of any size cost the same per frame.
+
+    The editor does not take input by itself: route typed text and keys to
+    {!Text_editor.update}, typically only while it has focus in the model.
+
+    Example:
+    {[
+      let log = Text_buffer.of_string (read_file "annotations.log")
+
+      let update msg model =
+        match msg with
+        | Msg.Edit input ->
+            let editor, edit = Text_editor.update model.editor input in
+            Option.iter send_to_peers edit;
+            ({ model with editor }, Cmd.none)
+
+      let view model = editor ~style:Styles.document model.editor
+
+      let subscriptions _model =
+        Sub.batch
+          [
+            Sub.on_text_input (fun text -> Msg.Edit (Text_editor.Input text));
+            Sub.on_key_down (fun key -> Msg.Edit (Text_editor.Key key));
+          ]
+    ]} *)
+
 val empty : 'msg node
 
+val static : ?width:int -> ?height:int -> (unit -> 'msg node) -> 'msg node
+(** [static build] is a subtree that never changes. It is built, laid out and
+    converted to primitives the first time it is shown, and the result is
+    reused for the life of the app. It is laid out again only when the size it
+    is given changes, and only translated when it moves. Nothing is compared,
+    so this is cheaper than any memoization.
+
+    The subtree is laid out on its own in the box it gets, which takes the
+    style of the subtree's root: give that root a size or let flex size the
+    box (e.g. with [flex_grow]), so a toolbar stretched across the window
+    follows resizes. A root that would size itself to its content has nothing
+    to size it here; pin the box with [width] and [height] instead. With
+    both, the box is exactly that size and flex neither grows nor shrinks it;
+    with one, only that side is set.
+
+    The cache lives in the returned node, so create it once, outside of
+    [view]. Apply {!map_msg} before hoisting: a static mapped inside [view]
+    starts a fresh cache every frame.
+
+    @raise Invalid_argument if [width] or [height] is not positive
+
+    Example:
+    {[
+      let toolbar =
+        static ~height:40 (fun () ->
+            view ~style:Styles.toolbar
+              [ text ~style:Styles.title "Untitled"; save_button ])
+
+      let app_view model = view [ toolbar; document model ]
+    ]} *)
+
+val throttled :
+  fps:float ->
+  ?width:int ->
+  ?height:int ->
+  ('a -> 'msg node) ->
+  'a ->
+  'msg node
+(** [throttled ~fps build] is a view function for a subtree that refreshes at
+    most [fps] times a second. Given a new input less than [1 / fps] seconds
+    after its last refresh, it keeps returning the node built for the old one,
+    and the runtime reuses that subtree's layout, bounds and primitives while
+    the rest of the frame is rebuilt. Clicks and hovers hit the reused bounds
+    and get the handlers of the reused node. Once the interval is over, the
+    next frame rebuilds it from the latest input, even if nothing else
+    changed by then.
+
+    Inputs are compared physically, so pass the part of the model the subtree
+    shows. Each refresh is a {!static}, sized the same way and pinned by
+    [width] and [height] when given. Charts inside draw new samples only when
+    it refreshes. Like {!static}, create it once, outside of [view].
+
+    @raise Invalid_argument if [fps], [width] or [height] is not positive
+
+    Example:
+    {[
+      let charts = throttled ~fps:5.0 (fun metrics -> dashboard_charts metrics)
+
+      let app_view model =
+        view [ clock model.time; cursor model.pointer; charts model.metrics ]
+    ]} *)
+
 (** {2 Primitive Constructors} *)
 
 val rectangle :
@@ -123,6 +410,10 @@ val ( <^> ) : 'a node -> ('a -> 'b) -> 'b node
 val run :
   window:Window.t ->
   ?subscriptions:('model -> 'msg Sub.t) ->
+  ?quality:Quality.config ->
+  ?msg_name:('msg -> string) ->
+  ?slow_update_ms:float ->
+  ?model_sample_ms:float ->
   init:'model ->
   update:('msg -> 'model -> 'model * Cmd.t) ->
   view:('model -> 'msg node) ->
@@ -130,6 +421,23 @@ val run :
   (unit, [ `Msg of string ]) result
 (** Run the UI application.
 
+    With [~quality], an adaptive quality governor watches frame times and
+    trades rendering quality for speed when frames run over budget (see
+    {!Quality}).
+
+    Every update is timed and charged to its message in {!Stats}, under the
+    name [~msg_name] gives it (by default, its constructor's position, which
+    only tells ordinary variants apart; give [~msg_name] for polymorphic
+    variants, records or tuples). With [~slow_update_ms], each update taking
+    longer than that is also logged to stderr with its message's name.
+
+    With [~model_sample_ms], the size of the model is measured every that
+    many milliseconds, in {!Idle} time, and kept in {!Stats.model_words}.
+    Measuring walks the whole model at once, so it waits for a frame with
+    enough slack, and samples are spaced further apart as the model grows,
+    keeping them to about one percent of the time.
+    Node and primitive counts of every rendered frame are kept in any case.
+
     Example:
     {[
       open Mlui
@@ -152,3 +460,35 @@ val run :
         let window = Window.make ~width:800 ~height:600 ~title:"My App" () in
         run ~window ~subscriptions ~init:(Model.init ()) ~update ~view ()
     ]} *)
+
+val run_windows :
+  windows:(Window.t * ('model -> 'msg node)) list ->
+  ?subscriptions:('model -> 'msg Sub.t) ->
+  ?quality:Quality.config ->
+  ?msg_name:('msg -> string) ->
+  ?slow_update_ms:float ->
+  ?model_sample_ms:float ->
+  init:'model ->
+  update:('msg -> 'model -> 'model * Cmd.t) ->
+  unit ->
+  (unit, [ `Msg of string ]) result
+(** Run one application across several windows.
+
+    Every window renders its own view of the shared model and does its own
+    hit-testing. All windows share a single GL context, so fonts, glyph atlases
+    and tessellation buffers are loaded once. A window is only redrawn when the
+    model changed since it was last drawn, or when it was exposed or resized.
+
+    Window commands such as {!Cmd.hide_window} apply to every window. Closing a
+    window hides it; the application quits when the last one is closed.
+
+    Example:
+    {[
+      let () =
+        let main = Window.make ~width:1280 ~height:720 ~title:"Overview" () in
+        let detail = Window.make ~width:640 ~height:480 ~title:"Detail" () in
+        run_windows
+          ~windows:[ (main, Overview.view); (detail, Detail.view) ]
+          ~subscriptions ~init:(Model.init ()) ~update ()
+        |> Result.iter_error (fun (`Msg msg) -> prerr_endline msg)
+    ]} *)
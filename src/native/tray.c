@@ -24,7 +24,9 @@
 }
 - (void)handleClick:(id)sender {
     if (callback != 0) {
-        // Call the OCaml callback
+        // Call the OCaml callback. This runs while SDL pumps Cocoa events,
+        // possibly inside a blocking wait; the OCaml side queues the click
+        // and posts a wakeup event so the wait returns.
         caml_callback(callback, Val_unit);
     }
 }
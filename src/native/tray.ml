@@ -2,13 +2,26 @@
 
 type t
 
+(* Room for queued clicks; clicks beyond that are dropped *)
+let queue_capacity = 256
+
 (* Global message queue for tray clicks *)
-let pending_messages : (unit -> unit) Queue.t = Queue.create ()
+let pending_messages : (unit -> unit) Mpsc_queue.t =
+  Mpsc_queue.create ~capacity:queue_capacity
 
 (* Message queue for subscription-based tray clicks *)
 (* This is checked by the runtime each frame *)
 type tray_message = { tray : t; dispatch : unit -> unit }
-let subscription_messages : tray_message Queue.t = Queue.create ()
+
+let subscription_messages : tray_message Mpsc_queue.t =
+  Mpsc_queue.create ~capacity:queue_capacity
+
+(* Callbacks may run on any thread; queue the click and wake the loop *)
+let enqueue queue message =
+  if Mpsc_queue.push queue message then
+    Wakeup.wake ()
+  else
+    Printf.eprintf "[Tray] Warning: click queue full, dropping click\n%!"
 
 (* External C functions *)
 external make_impl : string option -> t = "mlui_tray_make"
@@ -49,28 +62,24 @@ let remove tray = remove_impl tray
 
 let set_on_click tray on_click =
   (* Wrap callback to queue messages for main thread *)
-  set_on_click_impl tray (fun () -> Queue.add on_click pending_messages)
+  set_on_click_impl tray (fun () -> enqueue pending_messages on_click)
 
 let poll_events () =
-  (* Process all pending messages *)
-  while not (Queue.is_empty pending_messages) do
-    let msg_fn = Queue.take pending_messages in
-    msg_fn ()
-  done
+  (* Process the messages pending now; clicks arriving meanwhile wait for the
+     next call *)
+  Mpsc_queue.drain pending_messages ~limit:queue_capacity (fun msg_fn ->
+      msg_fn ())
+  |> ignore
 
 (* Internal function for subscription system *)
 let setup_subscription_callback tray on_msg =
   set_on_click_impl tray (fun () ->
-      Queue.add { tray; dispatch = on_msg } subscription_messages)
+      enqueue subscription_messages { tray; dispatch = on_msg })
 
 (* Internal function for subscription system *)
 let clear_subscription_callback tray = set_on_click_impl tray (fun () -> ())
 
 (* Internal function for subscription system - called by runtime *)
-let poll_subscription_messages () =
-  let messages = ref [] in
-  while not (Queue.is_empty subscription_messages) do
-    let msg = Queue.take subscription_messages in
-    messages := msg :: !messages
-  done;
-  List.rev !messages
+let drain_subscription_messages ~limit f =
+  ignore (Mpsc_queue.drain subscription_messages ~limit f);
+  not (Mpsc_queue.is_empty subscription_messages)
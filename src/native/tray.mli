@@ -61,7 +61,8 @@ val poll_events : unit -> unit
 
     This should be called regularly (e.g., in your event loop or animation frame
     handler) to process tray icon clicks. Click callbacks are queued and
-    executed when this is called.
+    executed when this is called; clicks arriving during the call wait for the
+    next one.
 
     Example:
     {[
@@ -88,6 +89,13 @@ val clear_subscription_callback : t -> unit
     system. This is called by the runtime when a tray subscription is removed.
 *)
 
-val poll_subscription_messages : unit -> tray_message list
-(** [poll_subscription_messages ()] retrieves all pending subscription messages.
-    This is called by the runtime each frame to process tray clicks. *)
+val drain_subscription_messages :
+  limit:int -> (tray_message -> unit) -> bool
+(** [drain_subscription_messages ~limit f] applies [f] to at most [limit]
+    pending subscription messages, oldest first, and tells whether more are
+    left. Does not allocate when nothing is pending. This is called by the
+    runtime each frame to process tray clicks.
+
+    Clicks are queued in a bounded lock-free queue, so callbacks may fire on
+    any thread or domain; clicks arriving while the queue is full are dropped.
+*)
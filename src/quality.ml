@@ -0,0 +1,92 @@
+(** Rendering quality tiers and adaptive quality configuration *)
+
+type tier = High | Medium | Low | Minimal
+
+type settings = {
+  antialias : bool;
+  render_scale : float;
+  path_stride : int;
+  decorations : bool;
+}
+
+let settings = function
+  | High ->
+      {
+        antialias = true;
+        render_scale = 1.0;
+        path_stride = 1;
+        decorations = true;
+      }
+  | Medium ->
+      {
+        antialias = false;
+        render_scale = 1.0;
+        path_stride = 1;
+        decorations = true;
+      }
+  | Low ->
+      {
+        antialias = false;
+        render_scale = 0.75;
+        path_stride = 2;
+        decorations = true;
+      }
+  | Minimal ->
+      {
+        antialias = false;
+        render_scale = 0.5;
+        path_stride = 4;
+        decorations = false;
+      }
+
+let lower = function
+  | High ->
+      Some Medium
+  | Medium ->
+      Some Low
+  | Low ->
+      Some Minimal
+  | Minimal ->
+      None
+
+let higher = function
+  | High ->
+      None
+  | Medium ->
+      Some High
+  | Low ->
+      Some Medium
+  | Minimal ->
+      Some Low
+
+let rank = function High -> 0 | Medium -> 1 | Low -> 2 | Minimal -> 3
+
+let to_string = function
+  | High ->
+      "high"
+  | Medium ->
+      "medium"
+  | Low ->
+      "low"
+  | Minimal ->
+      "minimal"
+
+type config = {
+  target_fps : float;
+  lowest_tier : tier;
+  sample_frames : int;
+  downgrade_ratio : float;
+  upgrade_ratio : float;
+  upgrade_after : int;
+}
+
+let make ?(target_fps = 60.0) ?(lowest_tier = Minimal) ?(sample_frames = 30)
+    ?(downgrade_ratio = 1.15) ?(upgrade_ratio = 0.6) ?(upgrade_after = 3) () =
+  {
+    target_fps;
+    lowest_tier;
+    sample_frames = max 1 sample_frames;
+    downgrade_ratio;
+    upgrade_ratio;
+    upgrade_after = max 1 upgrade_after;
+  }
@@ -0,0 +1,72 @@
+(** Rendering quality tiers and adaptive quality configuration.
+
+    When an application is run with a [~quality] configuration, the runtime
+    watches recent frame times and steps down through the tiers while frames
+    run over budget, and back up once there is headroom again. Apps can follow
+    tier changes with {!Subscription.on_quality_change}. *)
+
+type tier =
+  | High  (** Everything enabled *)
+  | Medium  (** Antialiasing disabled *)
+  | Low  (** Also renders at 75% resolution and draws every 2nd path point *)
+  | Minimal
+      (** Renders at 50% resolution, draws every 4th path point and drops
+          decorations *)
+
+type settings = {
+  antialias : bool;
+  render_scale : float;
+      (** Fraction of the drawable resolution that is rendered and then
+          upscaled to the window *)
+  path_stride : int;  (** Only every [path_stride]th point of a path is drawn *)
+  decorations : bool;
+      (** Borders and nodes styled with {!Style.with_decorative} *)
+}
+(** What the renderer does at a given tier *)
+
+val settings : tier -> settings
+
+val lower : tier -> tier option
+(** The next cheaper tier, if any *)
+
+val higher : tier -> tier option
+(** The next better tier, if any *)
+
+val rank : tier -> int
+(** [0] for [High] up to [3] for [Minimal] *)
+
+val to_string : tier -> string
+
+type config = {
+  target_fps : float;  (** Frame budget the governor aims for *)
+  lowest_tier : tier;  (** The governor never steps below this tier *)
+  sample_frames : int;  (** Number of frames averaged per decision *)
+  downgrade_ratio : float;
+      (** Step down when the average frame time exceeds the budget by this
+          factor *)
+  upgrade_ratio : float;
+      (** Consider stepping up when the average frame time is below this
+          fraction of the budget *)
+  upgrade_after : int;
+      (** Number of consecutive sample windows with headroom before stepping
+          up *)
+}
+
+val make :
+  ?target_fps:float ->
+  ?lowest_tier:tier ->
+  ?sample_frames:int ->
+  ?downgrade_ratio:float ->
+  ?upgrade_ratio:float ->
+  ?upgrade_after:int ->
+  unit ->
+  config
+(** Create a governor configuration. Defaults: 60 fps target, down to
+    [Minimal], 30-frame samples, step down above 115% of the budget, step up
+    after 3 samples below 60% of it.
+
+    Example:
+    {[
+      let quality = Quality.make ~target_fps:30.0 ~lowest_tier:Low () in
+      Mlui.run ~window ~quality ~init ~update ~view ()
+    ]} *)
@@ -0,0 +1,202 @@
+open Tgles2
+
+type pixels =
+  (int, Bigarray.int8_unsigned_elt, Bigarray.c_layout) Bigarray.Array1.t
+
+type values = (float, Bigarray.float32_elt, Bigarray.c_layout) Bigarray.Array1.t
+
+type source =
+  | Rgba
+  | Scalar of {
+      values : values;
+      low : float;
+      high : float;
+      lut : Bytes.t;  (* 256 RGBA entries *)
+    }
+
+type t = {
+  width : int;
+  height : int;
+  (* What is uploaded. For scalar rasters, the colormapped values *)
+  pixels : pixels;
+  source : source;
+  mutable texture : int option;
+  (* Rows [first_dirty] to [last_dirty] changed since the last upload; none
+     when [first_dirty > last_dirty] *)
+  mutable first_dirty : int;
+  mutable last_dirty : int;
+  mutable version : int;
+}
+
+let lut_size = 256
+
+let create_pixels ~width ~height =
+  let pixels =
+    Bigarray.(Array1.create int8_unsigned c_layout (width * height * 4))
+  in
+  Bigarray.Array1.fill pixels 0;
+  pixels
+
+let check_size name ~width ~height =
+  if width < 1 || height < 1 then
+    invalid_arg (name ^ ": width and height must be positive")
+
+let rgba ~width ~height =
+  check_size "Raster.rgba" ~width ~height;
+  {
+    width;
+    height;
+    pixels = create_pixels ~width ~height;
+    source = Rgba;
+    texture = None;
+    first_dirty = 0;
+    last_dirty = height - 1;
+    version = 0;
+  }
+
+let scalar ?(range = (0.0, 1.0)) ~colormap ~width ~height () =
+  check_size "Raster.scalar" ~width ~height;
+  let low, high = range in
+  if not (high > low) then
+    invalid_arg "Raster.scalar: range must be increasing";
+  let lut = Bytes.create (lut_size * 4) in
+  for i = 0 to lut_size - 1 do
+    let color : Color.t =
+      colormap (float_of_int i /. float_of_int (lut_size - 1))
+    in
+    Bytes.set_uint8 lut (i * 4) color.r;
+    Bytes.set_uint8 lut ((i * 4) + 1) color.g;
+    Bytes.set_uint8 lut ((i * 4) + 2) color.b;
+    Bytes.set_uint8 lut ((i * 4) + 3) color.a
+  done;
+  let values = Bigarray.(Array1.create float32 c_layout (width * height)) in
+  Bigarray.Array1.fill values low;
+  {
+    width;
+    height;
+    pixels = create_pixels ~width ~height;
+    source = Scalar { values; low; high; lut };
+    texture = None;
+    first_dirty = 0;
+    last_dirty = height - 1;
+    version = 0;
+  }
+
+let width t = t.width
+
+let version t = t.version
+
+let height t = t.height
+
+let pixels t =
+  match t.source with
+  | Rgba ->
+      t.pixels
+  | Scalar _ ->
+      invalid_arg "Raster.pixels: scalar raster"
+
+let values t =
+  match t.source with
+  | Scalar { values; _ } ->
+      values
+  | Rgba ->
+      invalid_arg "Raster.values: RGBA raster"
+
+let rows_changed t ~first ~count =
+  let last = min (t.height - 1) (first + count - 1) in
+  let first = max 0 first in
+  if first <= last then begin
+    t.first_dirty <- min t.first_dirty first;
+    t.last_dirty <- max t.last_dirty last;
+    t.version <- t.version + 1
+  end
+
+let changed t = rows_changed t ~first:0 ~count:t.height
+
+let check_point name t ~x ~y =
+  if x < 0 || x >= t.width || y < 0 || y >= t.height then
+    invalid_arg (name ^ ": out of bounds")
+
+let set_pixel t ~x ~y (color : Color.t) =
+  check_point "Raster.set_pixel" t ~x ~y;
+  let pixels = pixels t in
+  let offset = ((y * t.width) + x) * 4 in
+  pixels.{offset} <- color.r;
+  pixels.{offset + 1} <- color.g;
+  pixels.{offset + 2} <- color.b;
+  pixels.{offset + 3} <- color.a;
+  rows_changed t ~first:y ~count:1
+
+let set t ~x ~y value =
+  check_point "Raster.set" t ~x ~y;
+  (values t).{(y * t.width) + x} <- value;
+  rows_changed t ~first:y ~count:1
+
+let release t =
+  match t.texture with
+  | Some texture ->
+      Gl_quad.delete_texture texture;
+      t.texture <- None;
+      changed t
+  | None ->
+      ()
+
+(* Runs scalar rows [first] to [last] through the colormap *)
+let colormap_rows t ~first ~last =
+  match t.source with
+  | Rgba ->
+      ()
+  | Scalar { values; low; high; lut } ->
+      let scale = float_of_int (lut_size - 1) /. (high -. low) in
+      for i = first * t.width to ((last + 1) * t.width) - 1 do
+        let position = (values.{i} -. low) *. scale in
+        (* Written so that NaN maps to the first entry *)
+        let entry =
+          if not (position > 0.0) then
+            0
+          else if position >= float_of_int (lut_size - 1) then
+            lut_size - 1
+          else
+            int_of_float (position +. 0.5)
+        in
+        let pixel = i * 4 and color = entry * 4 in
+        t.pixels.{pixel} <- Bytes.get_uint8 lut color;
+        t.pixels.{pixel + 1} <- Bytes.get_uint8 lut (color + 1);
+        t.pixels.{pixel + 2} <- Bytes.get_uint8 lut (color + 2);
+        t.pixels.{pixel + 3} <- Bytes.get_uint8 lut (color + 3)
+      done
+
+(* Brings the texture up to date, uploading only the changed rows once it
+   exists, and returns it *)
+let upload t =
+  let first = t.first_dirty and last = t.last_dirty in
+  t.first_dirty <- t.height;
+  t.last_dirty <- -1;
+  match t.texture with
+  | None ->
+      colormap_rows t ~first:0 ~last:(t.height - 1);
+      let texture = Gl_quad.create_texture ~filter:Gl.nearest in
+      Gl.pixel_storei Gl.unpack_alignment 1;
+      Gl.tex_image2d Gl.texture_2d 0 Gl.rgba t.width t.height 0 Gl.rgba
+        Gl.unsigned_byte (`Data t.pixels);
+      t.texture <- Some texture;
+      texture
+  | Some texture ->
+      if first <= last then begin
+        colormap_rows t ~first ~last;
+        let row_bytes = t.width * 4 in
+        let rows =
+          Bigarray.Array1.sub t.pixels (first * row_bytes)
+            ((last - first + 1) * row_bytes)
+        in
+        Gl.bind_texture Gl.texture_2d texture;
+        Gl.pixel_storei Gl.unpack_alignment 1;
+        Gl.tex_sub_image2d Gl.texture_2d 0 0 first t.width (last - first + 1)
+          Gl.rgba Gl.unsigned_byte (`Data rows)
+      end;
+      texture
+
+let draw t ~viewport_width ~viewport_height ~x ~y ~w ~h =
+  let texture = upload t in
+  Gl_quad.draw ~texture ~viewport_width ~viewport_height ~x ~y ~w ~h
+    ~uv:(0.0, 0.0, 1.0, 1.0) ~blend:true
@@ -0,0 +1,92 @@
+(** Pixel grids for {!Mlui.raster}.
+
+    A raster is a [width] by [height] grid drawn as one texture, stretched
+    over its box, so a heatmap of a million cells costs one quad rather than
+    a million rectangles. Rasters hold either RGBA pixels or scalar values
+    that are colored through a colormap when uploaded.
+
+    Only the rows that changed since the last frame are uploaded again.
+    Changes made through {!set_pixel} and {!set} are tracked; after writing to
+    {!pixels} or {!values} directly, report the rows with {!rows_changed}.
+
+    A raster is mutable; keep it next to the model rather than in it, and
+    change it from [update] or subscriptions. Its texture lives until
+    {!release}. *)
+
+type t
+
+type pixels =
+  (int, Bigarray.int8_unsigned_elt, Bigarray.c_layout) Bigarray.Array1.t
+(** Row-major RGBA bytes, four per pixel, with the top row first *)
+
+type values = (float, Bigarray.float32_elt, Bigarray.c_layout) Bigarray.Array1.t
+(** Row-major values, one per pixel, with the top row first *)
+
+val rgba : width:int -> height:int -> t
+(** [rgba ~width ~height] is a transparent RGBA raster. *)
+
+val scalar :
+  ?range:float * float ->
+  colormap:(float -> Color.t) ->
+  width:int ->
+  height:int ->
+  unit ->
+  t
+(** [scalar ~colormap ~width ~height ()] is a raster of values, all at the
+    low end of [range] (default [(0.0, 1.0)]). [colormap] is sampled 256 times
+    at creation, from [0.0] for the low end of [range] to [1.0] for the high
+    end; values outside [range] take the color of the nearest end and NaN that
+    of the low end. *)
+
+val width : t -> int
+
+val height : t -> int
+
+val set_pixel : t -> x:int -> y:int -> Color.t -> unit
+(** [set_pixel t ~x ~y color] sets a pixel of an RGBA raster.
+
+    @raise Invalid_argument if [t] is scalar or the pixel is out of bounds *)
+
+val set : t -> x:int -> y:int -> float -> unit
+(** [set t ~x ~y value] sets a value of a scalar raster.
+
+    @raise Invalid_argument if [t] is RGBA or the pixel is out of bounds *)
+
+val pixels : t -> pixels
+(** The pixels of an RGBA raster, for writing whole rows at a time.
+
+    @raise Invalid_argument if [t] is scalar *)
+
+val values : t -> values
+(** The values of a scalar raster, for writing whole rows at a time.
+
+    @raise Invalid_argument if [t] is RGBA *)
+
+val rows_changed : t -> first:int -> count:int -> unit
+(** [rows_changed t ~first ~count] marks [count] rows from [first] as changed
+    after writing to {!pixels} or {!values} directly. *)
+
+val changed : t -> unit
+(** [changed t] marks every row as changed. *)
+
+val release : t -> unit
+(** [release t] frees the texture of [t]. It is created again if [t] is drawn
+    afterwards. *)
+
+(** {2 Internal API for the Runtime} *)
+
+val version : t -> int
+(** [version t] changes whenever rows are marked as changed. *)
+
+val draw :
+  t ->
+  viewport_width:float ->
+  viewport_height:float ->
+  x:float ->
+  y:float ->
+  w:float ->
+  h:float ->
+  unit
+(** [draw t ~viewport_width ~viewport_height ~x ~y ~w ~h] uploads the changed
+    rows of [t] and draws it over the pixel rectangle [x, y, w, h] of the
+    current viewport. Needs the GL context current. *)
@@ -0,0 +1,356 @@
+type decimation = {
+  of_version : int;
+  of_width : float;
+  of_height : float;
+  of_range : (float * float) option;
+  points : Float.Array.t;
+}
+
+(* M4 summaries of the samples per bucket of x, kept in step with the
+   series so that decimating a streaming series costs time in the samples
+   pushed since last time and the number of buckets, not in its length.
+   Samples are numbered in push order; a bucket holds a run of consecutive
+   samples and records the numbers of its first, lowest, highest and last
+   one. Keys count buckets of [key_width] from [origin], and buckets are
+   merged in pairs once there are more than two per pixel column. *)
+type buckets = {
+  columns : int;
+  origin : float;
+  mutable key_width : float;  (* Zero until two samples differ in x *)
+  mutable head : int;  (* Slot of the first bucket *)
+  mutable count : int;
+  keys : int array;
+  sizes : int array;
+  samples : int array;  (* Four per slot *)
+  mutable start : int;  (* Number of the oldest sample summarised *)
+  mutable next : int;  (* Number of the next sample to summarise *)
+}
+
+type t = {
+  xs : Float.Array.t;
+  ys : Float.Array.t;
+  mutable first : int;  (* Slot of the oldest sample *)
+  mutable length : int;
+  mutable dropped : int;  (* Number of the oldest sample *)
+  mutable version : int;
+  mutable buckets : buckets option;
+  mutable decimated : decimation option;
+}
+
+let create ~capacity =
+  if capacity < 1 then invalid_arg "Series.create: capacity must be positive";
+  {
+    xs = Float.Array.create capacity;
+    ys = Float.Array.create capacity;
+    first = 0;
+    length = 0;
+    dropped = 0;
+    version = 0;
+    buckets = None;
+    decimated = None;
+  }
+
+let capacity t = Float.Array.length t.xs
+
+let length t = t.length
+
+let version t = t.version
+
+let slot t i = (t.first + i) mod capacity t
+
+let push t ~x ~y =
+  let slot =
+    if t.length < capacity t then begin
+      t.length <- t.length + 1;
+      slot t (t.length - 1)
+    end
+    else begin
+      let oldest = t.first in
+      t.first <- slot t 1;
+      t.dropped <- t.dropped + 1;
+      oldest
+    end
+  in
+  Float.Array.set t.xs slot x;
+  Float.Array.set t.ys slot y;
+  t.version <- t.version + 1
+
+let clear t =
+  t.first <- 0;
+  t.dropped <- t.dropped + t.length;
+  t.length <- 0;
+  t.version <- t.version + 1
+
+let x t i = Float.Array.get t.xs (slot t i)
+
+let y t i = Float.Array.get t.ys (slot t i)
+
+let number_x t n = x t (n - t.dropped)
+
+let number_y t n = y t (n - t.dropped)
+
+let empty_buckets t ~columns =
+  let capacity = (4 * columns) + 2 in
+  let origin, key_width =
+    if t.length = 0 then
+      (0.0, 0.0)
+    else
+      let span = x t (t.length - 1) -. x t 0 in
+      ( x t 0,
+        if span > 0.0 then
+          span /. float_of_int columns
+        else
+          0.0 )
+  in
+  {
+    columns;
+    origin;
+    key_width;
+    head = 0;
+    count = 0;
+    keys = Array.make capacity 0;
+    sizes = Array.make capacity 0;
+    samples = Array.make (4 * capacity) 0;
+    start = t.dropped;
+    next = t.dropped;
+  }
+
+(* Adds [size] samples, whose lowest, highest and last are given, to the
+   bucket in slot [s], which they follow *)
+let extend t b s ~size ~lowest ~highest ~last =
+  b.sizes.(s) <- b.sizes.(s) + size;
+  if number_y t lowest < number_y t b.samples.((4 * s) + 1) then
+    b.samples.((4 * s) + 1) <- lowest;
+  if number_y t highest > number_y t b.samples.((4 * s) + 2) then
+    b.samples.((4 * s) + 2) <- highest;
+  b.samples.((4 * s) + 3) <- last
+
+let append_bucket b ~key n =
+  if b.head + b.count = Array.length b.keys then begin
+    Array.blit b.keys b.head b.keys 0 b.count;
+    Array.blit b.sizes b.head b.sizes 0 b.count;
+    Array.blit b.samples (4 * b.head) b.samples 0 (4 * b.count);
+    b.head <- 0
+  end;
+  let s = b.head + b.count in
+  b.keys.(s) <- key;
+  b.sizes.(s) <- 1;
+  Array.fill b.samples (4 * s) 4 n;
+  b.count <- b.count + 1
+
+(* Doubles the bucket width, merging buckets in pairs. Slots are rewritten
+   from the first on, never ahead of the slot being read. *)
+let halve t b =
+  b.key_width <- b.key_width *. 2.0;
+  let out = ref 0 in
+  for i = 0 to b.count - 1 do
+    let s = b.head + i in
+    let key = b.keys.(s) / 2 in
+    if !out > 0 && b.keys.(!out - 1) = key then
+      extend t b (!out - 1) ~size:b.sizes.(s)
+        ~lowest:b.samples.((4 * s) + 1)
+        ~highest:b.samples.((4 * s) + 2)
+        ~last:b.samples.((4 * s) + 3)
+    else begin
+      b.keys.(!out) <- key;
+      b.sizes.(!out) <- b.sizes.(s);
+      Array.blit b.samples (4 * s) b.samples (4 * !out) 4;
+      incr out
+    end
+  done;
+  b.head <- 0;
+  b.count <- !out
+
+let fold t b n =
+  let x = number_x t n in
+  if b.key_width = 0.0 && x > b.origin then
+    b.key_width <- (x -. b.origin) /. float_of_int b.columns;
+  let key =
+    if b.key_width > 0.0 then
+      max 0 (int_of_float ((x -. b.origin) /. b.key_width))
+    else
+      0
+  in
+  let last = b.head + b.count - 1 in
+  (* Samples out of x order join the last bucket *)
+  if b.count > 0 && key <= b.keys.(last) then
+    extend t b last ~size:1 ~lowest:n ~highest:n ~last:n
+  else begin
+    append_bucket b ~key n;
+    (* Keys with gaps between them may take more than one halving *)
+    while b.count > 2 * b.columns do
+      halve t b
+    done
+  end
+
+(* Forgets the [evicted] oldest samples summarised. A bucket left partly
+   evicted is summarised again from the samples it still holds. *)
+let rec drop_front t b evicted =
+  if evicted > 0 && b.count > 0 then begin
+    let s = b.head in
+    let size = b.sizes.(s) in
+    if evicted >= size then begin
+      b.head <- b.head + 1;
+      b.count <- b.count - 1;
+      drop_front t b (evicted - size)
+    end
+    else begin
+      let first = b.samples.(4 * s) + evicted in
+      b.sizes.(s) <- 1;
+      Array.fill b.samples (4 * s) 4 first;
+      for n = first + 1 to first + size - evicted - 1 do
+        extend t b s ~size:1 ~lowest:n ~highest:n ~last:n
+      done
+    end
+  end
+
+(* Brings [b] up to date with the samples held. Returns [false] when it has
+   to be rebuilt: nothing summarised is left, or the samples now span so
+   few buckets that columns would go without one. *)
+let sync t b =
+  drop_front t b (min t.dropped b.next - b.start);
+  b.start <- t.dropped;
+  b.next <- max b.next t.dropped;
+  if b.count = 0 then
+    false
+  else begin
+    for n = b.next to t.dropped + t.length - 1 do
+      fold t b n
+    done;
+    b.next <- t.dropped + t.length;
+    let span = x t (t.length - 1) -. x t 0 in
+    not (span > 0.0 && b.key_width *. float_of_int b.columns > 2.0 *. span)
+  end
+
+let buckets t ~columns =
+  match t.buckets with
+  | Some b when b.columns = columns && sync t b ->
+      b
+  | _ ->
+      let b = empty_buckets t ~columns in
+      for n = t.dropped to t.dropped + t.length - 1 do
+        fold t b n
+      done;
+      b.next <- t.dropped + t.length;
+      t.buckets <- Some b;
+      b
+
+(* M4 decimation: the first, lowest, highest and last sample of each pixel
+   column, in sample order. Lines between them cover the same pixels as the
+   line through every sample. A column takes the buckets that start in it;
+   buckets are kept under two columns wide, and every point keeps its own
+   x. *)
+let decimate_samples t ~width ~height ~y_range =
+  let columns = max 1 (int_of_float (Float.ceil width)) in
+  let b = buckets t ~columns in
+  let points = Float.Array.create (8 * b.count) in
+  let count = ref 0 in
+  let x_first = x t 0 in
+  let x_span = x t (t.length - 1) -. x_first in
+  let y_low, y_high =
+    match y_range with
+    | Some range ->
+        range
+    | None ->
+        let low = ref Float.infinity and high = ref Float.neg_infinity in
+        for i = 0 to b.count - 1 do
+          let s = b.head + i in
+          let lowest = number_y t b.samples.((4 * s) + 1) in
+          let highest = number_y t b.samples.((4 * s) + 2) in
+          if lowest < !low then low := lowest;
+          if highest > !high then high := highest
+        done;
+        (!low, !high)
+  in
+  let y_low, y_high =
+    if y_high > y_low then
+      (y_low, y_high)
+    else
+      (y_low -. 0.5, y_low +. 0.5)
+  in
+  let emit n =
+    let px =
+      if x_span > 0.0 then
+        (number_x t n -. x_first) /. x_span *. width
+      else
+        0.0
+    in
+    let py =
+      height -. ((number_y t n -. y_low) /. (y_high -. y_low) *. height)
+    in
+    Float.Array.set points !count px;
+    Float.Array.set points (!count + 1) py;
+    count := !count + 2
+  in
+  let column_of n =
+    if x_span > 0.0 then
+      min (columns - 1)
+        (int_of_float
+           ((number_x t n -. x_first) /. x_span *. float_of_int columns))
+    else
+      0
+  in
+  let flush ~first ~lowest ~highest ~last =
+    emit first;
+    let middle_first, middle_second =
+      if lowest < highest then
+        (lowest, highest)
+      else
+        (highest, lowest)
+    in
+    if middle_first <> first then emit middle_first;
+    if middle_second <> middle_first && middle_second <> first then
+      emit middle_second;
+    if last <> middle_second && last <> first then emit last
+  in
+  let sample s k = b.samples.((4 * s) + k) in
+  let column = ref (column_of (sample b.head 0)) in
+  let first = ref (sample b.head 0) in
+  let lowest = ref (sample b.head 1) and highest = ref (sample b.head 2) in
+  let last = ref (sample b.head 3) in
+  for i = 1 to b.count - 1 do
+    let s = b.head + i in
+    let c = column_of (sample s 0) in
+    if c <> !column then begin
+      flush ~first:!first ~lowest:!lowest ~highest:!highest ~last:!last;
+      column := c;
+      first := sample s 0;
+      lowest := sample s 1;
+      highest := sample s 2
+    end
+    else begin
+      if number_y t (sample s 1) < number_y t !lowest then
+        lowest := sample s 1;
+      if number_y t (sample s 2) > number_y t !highest then
+        highest := sample s 2
+    end;
+    last := sample s 3
+  done;
+  flush ~first:!first ~lowest:!lowest ~highest:!highest ~last:!last;
+  Float.Array.sub points 0 !count
+
+let decimate t ~width ~height ~y_range =
+  match t.decimated with
+  | Some decimated
+    when decimated.of_version = t.version
+         && decimated.of_width = width
+         && decimated.of_height = height
+         && decimated.of_range = y_range ->
+      decimated.points
+  | _ ->
+      let points =
+        if t.length = 0 then
+          Float.Array.create 0
+        else
+          decimate_samples t ~width ~height ~y_range
+      in
+      t.decimated <-
+        Some
+          {
+            of_version = t.version;
+            of_width = width;
+            of_height = height;
+            of_range = y_range;
+            points;
+          };
+      points
@@ -0,0 +1,60 @@
+(** Sample series for {!Mlui.chart}.
+
+    A series keeps up to [capacity] samples in a ring buffer of unboxed
+    floats: appending is constant time and allocates nothing, and once the
+    buffer is full each new sample replaces the oldest one. Samples are
+    expected in increasing [x] order, such as timestamps.
+
+    Charts do not draw every sample. At render time a series is decimated
+    per pixel column, keeping the first, lowest, highest and last sample of
+    each column, so a chart draws at most four vertices per column whatever
+    the number of samples and still looks the same as the full line. The
+    columns are kept between frames and new samples are folded into them,
+    so a streaming chart costs time in the samples pushed since the last
+    frame; they are only rebuilt when the chart is resized or the span of
+    the samples shrinks to well under what it was.
+
+    A series is mutable; keep it next to the model rather than in it, and
+    push to it from [update] or subscriptions. *)
+
+type t
+
+val create : capacity:int -> t
+(** [create ~capacity] is an empty series holding at most [capacity]
+    samples. *)
+
+val push : t -> x:float -> y:float -> unit
+(** [push t ~x ~y] appends a sample, dropping the oldest one when [t] is
+    full. *)
+
+val clear : t -> unit
+(** [clear t] removes all samples. *)
+
+val length : t -> int
+(** Number of samples held *)
+
+val capacity : t -> int
+
+val x : t -> int -> float
+(** [x t i] is the [x] of the [i]-th sample, the oldest being [0] *)
+
+val y : t -> int -> float
+(** [y t i] is the [y] of the [i]-th sample, the oldest being [0] *)
+
+(** {2 Internal API for the Runtime} *)
+
+val version : t -> int
+(** [version t] changes whenever samples are pushed or cleared. *)
+
+val decimate :
+  t ->
+  width:float ->
+  height:float ->
+  y_range:(float * float) option ->
+  Float.Array.t
+(** [decimate t ~width ~height ~y_range] is the line through [t] scaled to a
+    [width] by [height] box, as [x0; y0; x1; y1; ...] relative to its top left
+    corner, with at most four points per pixel column. The samples span the
+    box horizontally, and [y_range] vertically, by default the range of the
+    samples. The result is cached until [t] or the arguments change; do not
+    modify it. *)
@@ -0,0 +1,114 @@
+type message = { name : string; count : int; total_ms : float; max_ms : float }
+
+type update_entry = {
+  mutable count : int;
+  mutable total_ms : float;
+  mutable max_ms : float;
+}
+
+(* Keyed by message name. Only the main loop writes it. *)
+let updates : (string, update_entry) Hashtbl.t = Hashtbl.create 16
+
+let record_update ~name ~ms =
+  match Hashtbl.find_opt updates name with
+  | Some entry ->
+      entry.count <- entry.count + 1;
+      entry.total_ms <- entry.total_ms +. ms;
+      if ms > entry.max_ms then entry.max_ms <- ms
+  | None ->
+      Hashtbl.add updates name { count = 1; total_ms = ms; max_ms = ms }
+
+let messages () =
+  Hashtbl.fold
+    (fun name (entry : update_entry) messages ->
+      {
+        name;
+        count = entry.count;
+        total_ms = entry.total_ms;
+        max_ms = entry.max_ms;
+      }
+      :: messages)
+    updates []
+  |> List.sort (fun (a : message) (b : message) ->
+         Float.compare b.total_ms a.total_ms)
+
+let top_messages n = List.filteri (fun i _ -> i < n) (messages ())
+
+(* Recent history as time series, in seconds since the app started *)
+let history = 4096
+
+let nodes = Series.create ~capacity:history
+
+let primitives = Series.create ~capacity:history
+
+let model_words = Series.create ~capacity:history
+
+let record_frame ~time ~nodes:node_count ~primitives:primitive_count =
+  Series.push nodes ~x:time ~y:(float_of_int node_count);
+  Series.push primitives ~x:time ~y:(float_of_int primitive_count)
+
+let record_model ~time ~words =
+  Series.push model_words ~x:time ~y:(float_of_int words)
+
+let reset () =
+  Hashtbl.reset updates;
+  Series.clear nodes;
+  Series.clear primitives;
+  Series.clear model_words
+
+let report ?(limit = 10) () =
+  let buffer = Buffer.create 256 in
+  Buffer.add_string buffer
+    (Printf.sprintf "%-40s %8s %10s %8s\n" "message" "count" "total ms"
+       "max ms");
+  List.iter
+    (fun message ->
+      Buffer.add_string buffer
+        (Printf.sprintf "%-40s %8d %10.1f %8.1f\n" message.name message.count
+           message.total_ms message.max_ms))
+    (top_messages limit);
+  Buffer.contents buffer
+
+(* Names for messages without a classifier. Obj exposes which constructor a
+   variant value was built with: constant constructors are immediate
+   integers numbered in declaration order, and the others are blocks tagged
+   by their position among the constructors with arguments. Names are made
+   once per constructor, so naming a message allocates nothing. Tags and
+   small integers index arrays; other integers, such as the hashes of
+   polymorphic variants, go through a table. *)
+let small_constants = 64
+
+let constant_names : string option array = Array.make small_constants None
+
+let large_constant_names : (int, string) Hashtbl.t = Hashtbl.create 16
+
+let block_names : string option array = Array.make 256 None
+
+let memoized names index make =
+  match names.(index) with
+  | Some name ->
+      name
+  | None ->
+      let name = make index in
+      names.(index) <- Some name;
+      name
+
+let constant_name n =
+  if n >= 0 && n < small_constants then
+    memoized constant_names n (Printf.sprintf "constant constructor %d")
+  else
+    match Hashtbl.find_opt large_constant_names n with
+    | Some name ->
+        name
+    | None ->
+        let name = Printf.sprintf "constant constructor %d" n in
+        Hashtbl.add large_constant_names n name;
+        name
+
+let constructor_name msg =
+  let repr = Obj.repr msg in
+  if Obj.is_int repr then
+    constant_name (Obj.obj repr : int)
+  else
+    memoized block_names (Obj.tag repr)
+      (Printf.sprintf "constructor with arguments %d")
@@ -0,0 +1,83 @@
+(** Where the time goes in a running app.
+
+    The runtime times every call to [update] and charges it to the message's
+    name. Names come from the [~msg_name] classifier given to {!Mlui.run}, or
+    by default from the message's constructor, which is only known by
+    position: ["constant constructor 2"] is the third constructor without
+    arguments, and ["constructor with arguments 0"] the first one with
+    arguments. To see individual slow updates as they happen, pass
+    [~slow_update_ms] to {!Mlui.run}.
+
+    The default names only tell the constructors of an ordinary variant
+    apart. Polymorphic variants with arguments all count as
+    ["constructor with arguments 0"], and those without are named after
+    their hash. Records, tuples and other types that are not variants are
+    all charged to the same name. For such messages, pass [~msg_name].
+
+    Sizes of the model and of each frame are kept as time series.
+
+    Statistics are kept from the start of the app, or from the last
+    {!reset}. Read them from [update] or [view], which run on the main loop. *)
+
+type message = {
+  name : string;
+  count : int;  (** Updates handled *)
+  total_ms : float;  (** Time spent in [update] *)
+  max_ms : float;  (** Slowest single update *)
+}
+
+val messages : unit -> message list
+(** Statistics for each message name seen, most total time first *)
+
+val top_messages : int -> message list
+(** [top_messages n] is the first [n] of {!messages}. *)
+
+val report : ?limit:int -> unit -> string
+(** [report ()] is a table of the [limit] (default [10]) most expensive
+    messages, for printing.
+
+    Example:
+    {[
+      let update msg model =
+        match msg with
+        | Msg.Key "F4" ->
+            print_string (Stats.report ());
+            (model, Cmd.none)
+        | ...
+    ]} *)
+
+(** {2 Sizes over time}
+
+    The series below keep the last 4096 samples, with [x] in seconds since
+    the app started, so they can be shown with {!Mlui.chart} or scanned for
+    growth. A model or a view that keeps growing while the app does the same
+    thing points at data that accumulates, such as a list that is only ever
+    appended to. *)
+
+val nodes : Series.t
+(** Nodes laid out in each rendered frame, summed over windows *)
+
+val primitives : Series.t
+(** Primitives drawn in each rendered frame, summed over windows *)
+
+val model_words : Series.t
+(** Words reachable from the model, sampled every [~model_sample_ms] given to
+    {!Mlui.run}, or less often when sampling a large model would take more
+    than about one percent of the time; empty without it. Counts the whole
+    model, shared data included, but not series, rasters or buffers kept next
+    to it. *)
+
+val reset : unit -> unit
+(** [reset ()] forgets all statistics. *)
+
+(** {2 Internal API for the Runtime} *)
+
+val record_update : name:string -> ms:float -> unit
+
+val record_frame : time:float -> nodes:int -> primitives:int -> unit
+
+val record_model : time:float -> words:int -> unit
+
+val constructor_name : 'msg -> string
+(** Name of the constructor a message was built with, by position. Only
+    meaningful for ordinary variants. *)
@@ -45,6 +45,7 @@ type t = {
   flex_shrink : float option;
   flex_basis : float option;
   transform : transform option;
+  decorative : bool option;
 }
 
 let default =
@@ -69,6 +70,7 @@ let default =
     flex_shrink = None;
     flex_basis = None;
     transform = None;
+    decorative = None;
   }
 
 let with_background color style = { style with background_color = Some color }
@@ -123,3 +125,5 @@ let with_transform transform style = { style with transform = Some transform }
 
 let with_position_type pos_type style =
   { style with position_type = Some pos_type }
+
+let with_decorative style = { style with decorative = Some true }
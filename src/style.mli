@@ -57,6 +57,7 @@ type t = {
   flex_shrink : float option;
   flex_basis : float option;
   transform : transform option;
+  decorative : bool option;
 }
 (** Style type containing all visual and layout properties *)
 
@@ -114,3 +115,8 @@ val with_position_type : position_type -> t -> t
 
 val with_transform : transform -> t -> t
 (** Set transform for visual effects *)
+
+val with_decorative : t -> t
+(** Mark a node and its subtree as decorative. Decorative content is dropped
+    first when the adaptive quality governor runs out of frame budget (see
+    {!Quality}). *)
@@ -6,12 +6,23 @@ type 'msg t =
   | None
   | Batch of 'msg t list
   | AnimationFrame of (float -> 'msg)
+  | FixedStep of {
+      hz : float;
+      max_steps : int;
+      step : float -> 'msg;
+      alpha : (float -> 'msg) option;
+    }
   | KeyUp of (string -> 'msg)
   | KeyDown of (string -> 'msg)
+  | TextInput of (string -> 'msg)
   | MouseDown of (int -> int -> 'msg)
   | MouseUp of (int -> int -> 'msg)
   | MouseMove of (int -> int -> 'msg)
   | TrayClick of (Tray.t * 'msg)
+  | Inbox of 'msg Inbox.t
+  | VisibilityChange of (bool -> 'msg)
+  | FocusChange of (bool -> 'msg)
+  | QualityChange of (Quality.tier -> 'msg)
   | Quit of 'msg
 
 (* Subscription constructors *)
@@ -31,16 +42,32 @@ let batch subs =
 
 let on_animation_frame f = AnimationFrame f
 
+let on_fixed_step ?(max_steps = 5) ?alpha ~hz step =
+  if not (hz > 0.0) then invalid_arg "Sub.on_fixed_step: hz must be positive";
+  FixedStep { hz; max_steps = max 1 max_steps; step; alpha }
+
 (* Application subscriptions *)
 
 let on_quit msg = Quit msg
 
+(* Window subscriptions *)
+
+let on_visibility_change f = VisibilityChange f
+
+let on_focus_change f = FocusChange f
+
+(* Rendering subscriptions *)
+
+let on_quality_change f = QualityChange f
+
 (* Keyboard subscriptions *)
 
 let on_key_up f = KeyUp f
 
 let on_key_down f = KeyDown f
 
+let on_text_input f = TextInput f
+
 (* Mouse subscriptions *)
 
 let on_mouse_down f = MouseDown f
@@ -49,6 +76,10 @@ let on_mouse_up f = MouseUp f
 
 let on_mouse_move f = MouseMove f
 
+(* Background subscriptions *)
+
+let on_inbox inbox = Inbox inbox
+
 (* Tray subscriptions *)
 
 module Tray = struct
@@ -64,10 +95,17 @@ let rec equal : 'msg 'msg2. 'msg t -> 'msg2 t -> bool =
       true
   | AnimationFrame _, AnimationFrame _ ->
       true
+  | ( FixedStep { hz = hz1; max_steps = max_steps1; alpha = alpha1; _ },
+      FixedStep { hz = hz2; max_steps = max_steps2; alpha = alpha2; _ } ) ->
+      hz1 = hz2
+      && max_steps1 = max_steps2
+      && Option.is_some alpha1 = Option.is_some alpha2
   | KeyUp _, KeyUp _ ->
       true
   | KeyDown _, KeyDown _ ->
       true
+  | TextInput _, TextInput _ ->
+      true
   | MouseDown _, MouseDown _ ->
       true
   | MouseUp _, MouseUp _ ->
@@ -76,6 +114,14 @@ let rec equal : 'msg 'msg2. 'msg t -> 'msg2 t -> bool =
       true
   | TrayClick (t1, _), TrayClick (t2, _) ->
       t1 == t2
+  | Inbox i1, Inbox i2 ->
+      Obj.repr i1 == Obj.repr i2
+  | VisibilityChange _, VisibilityChange _ ->
+      true
+  | FocusChange _, FocusChange _ ->
+      true
+  | QualityChange _, QualityChange _ ->
+      true
   | Quit _, Quit _ ->
       true
   | Batch subs1, Batch subs2 ->
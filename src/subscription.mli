@@ -14,12 +14,23 @@ type 'msg t =
   | None
   | Batch of 'msg t list
   | AnimationFrame of (float -> 'msg)
+  | FixedStep of {
+      hz : float;
+      max_steps : int;
+      step : float -> 'msg;
+      alpha : (float -> 'msg) option;
+    }
   | KeyUp of (string -> 'msg)
   | KeyDown of (string -> 'msg)
+  | TextInput of (string -> 'msg)
   | MouseDown of (int -> int -> 'msg)
   | MouseUp of (int -> int -> 'msg)
   | MouseMove of (int -> int -> 'msg)
   | TrayClick of (Tray.t * 'msg)
+  | Inbox of 'msg Inbox.t
+  | VisibilityChange of (bool -> 'msg)
+  | FocusChange of (bool -> 'msg)
+  | QualityChange of (Quality.tier -> 'msg)
   | Quit of 'msg
       (** A subscription that can produce messages of type ['msg].
 
@@ -68,6 +79,36 @@ val on_animation_frame : (float -> 'msg) -> 'msg t
         Sub.on_animation_frame (fun delta -> Msg.Tick delta)
     ]} *)
 
+val on_fixed_step :
+  ?max_steps:int ->
+  ?alpha:(float -> 'msg) ->
+  hz:float ->
+  (float -> 'msg) ->
+  'msg t
+(** Subscribe to simulation steps of a fixed length, [1 / hz] seconds, which
+    the callback receives. The runtime adds up the real time between frames,
+    measured with the high-resolution counter, and delivers as many steps as
+    fit into it, so a simulation advances the same at 30 and at 144 frames
+    per second. A frame may bring no step or several.
+
+    At most [max_steps] (default [5]) steps are delivered per frame. Time
+    beyond that is dropped, so that a slow step cannot make the next frame
+    owe even more of them; the simulation then runs slower than real time.
+
+    After the steps of each frame, [alpha] gets the fraction of a step that
+    is left over, at least [0.0] and below [1.0]. Draw the state that far
+    towards the next step to move smoothly between steps.
+
+    @raise Invalid_argument if [hz] is not positive
+
+    Example:
+    {[
+      let subscriptions _model =
+        Sub.on_fixed_step ~hz:120.0
+          ~alpha:(fun alpha -> Msg.Blend alpha)
+          (fun dt -> Msg.Step dt)
+    ]} *)
+
 (** {1 Application Subscriptions} *)
 
 val on_quit : 'msg -> 'msg t
@@ -81,6 +122,48 @@ val on_quit : 'msg -> 'msg t
       let subscriptions model = Sub.on_quit Msg.Quit
     ]} *)
 
+(** {1 Window Subscriptions} *)
+
+val on_visibility_change : (bool -> 'msg) -> 'msg t
+(** Subscribe to application visibility changes. The callback receives [true]
+    when at least one window becomes visible again and [false] once every
+    window is hidden or minimized.
+
+    Hidden windows are not rendered, but subscriptions keep being processed at
+    a reduced rate.
+
+    Example:
+    {[
+      let subscriptions model =
+        Sub.on_visibility_change (fun visible -> Msg.VisibilityChanged visible)
+    ]} *)
+
+val on_focus_change : (bool -> 'msg) -> 'msg t
+(** Subscribe to application focus changes. The callback receives [true] when
+    one of the windows gains input focus and [false] when none has it.
+
+    See {!Window.make}'s [background_fps] to lower the frame rate while
+    unfocused.
+
+    Example:
+    {[
+      let subscriptions model =
+        Sub.on_focus_change (fun focused -> Msg.FocusChanged focused)
+    ]} *)
+
+(** {1 Rendering Subscriptions} *)
+
+val on_quality_change : (Quality.tier -> 'msg) -> 'msg t
+(** Subscribe to quality tier changes made by the adaptive quality governor
+    (see [~quality] on {!Mlui.run}). Useful to pause optional work, such as
+    particle effects, while the app runs at a reduced tier.
+
+    Example:
+    {[
+      let subscriptions model =
+        Sub.on_quality_change (fun tier -> Msg.QualityChanged tier)
+    ]} *)
+
 (** {1 Keyboard Subscriptions} *)
 
 val on_key_up : (string -> 'msg) -> 'msg t
@@ -101,6 +184,25 @@ val on_key_down : (string -> 'msg) -> 'msg t
       let subscriptions model = Sub.on_key_down (fun key -> Msg.KeyPressed key)
     ]} *)
 
+val on_text_input : (string -> 'msg) -> 'msg t
+(** Subscribe to typed text. The callback receives UTF-8 text as the
+    keyboard layout and input method produce it, usually one character at a
+    time; keys that type nothing, such as Backspace or the arrows, only come
+    through {!on_key_down}.
+
+    Example:
+    {[
+      let subscriptions model =
+        if model.editing then
+          Sub.batch
+            [
+              Sub.on_text_input (fun text -> Msg.Edit (Text_editor.Input text));
+              Sub.on_key_down (fun key -> Msg.Edit (Text_editor.Key key));
+            ]
+        else
+          Sub.none
+    ]} *)
+
 (** {1 Mouse Subscriptions} *)
 
 val on_mouse_down : (int -> int -> 'msg) -> 'msg t
@@ -138,6 +240,18 @@ val on_mouse_move : (int -> int -> 'msg) -> 'msg t
           Sub.none
     ]} *)
 
+(** {1 Background Subscriptions} *)
+
+val on_inbox : 'msg Inbox.t -> 'msg t
+(** Subscribe to the messages posted to an inbox, typically by other domains
+    or threads. They are handled as background work: after pending input,
+    and only for a bounded slice of each frame (see {!Inbox}).
+
+    Example:
+    {[
+      let subscriptions _model = Sub.on_inbox telemetry
+    ]} *)
+
 (** {1 System Tray Subscriptions} *)
 
 module Tray : sig
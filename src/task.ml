@@ -0,0 +1,107 @@
+(* Tasks are deep effect handlers: yielding performs [Yield], whose handler
+   keeps the continuation and puts the task back in the queue. Resuming
+   continues it, or discontinues it with [Cancelled] so finalizers run. *)
+
+exception Cancelled
+
+type _ Effect.t += Yield : unit Effect.t
+
+type t = {
+  mutable resume : unit -> unit;
+  mutable cancelled : bool;
+  mutable finished : bool;
+}
+
+let ready : t Queue.t = Queue.create ()
+
+(* The task being resumed, and whether its share of the frame is used up *)
+let current : t option ref = ref None
+let slice_over = ref (fun () -> false)
+
+let yield () =
+  match !current with
+  | Some task when task.cancelled ->
+      raise Cancelled
+  | Some _ when !slice_over () ->
+      Effect.perform Yield
+  | _ ->
+      ()
+
+let handler task =
+  let open Effect.Deep in
+  {
+    retc = (fun () -> task.finished <- true);
+    exnc =
+      (fun exn ->
+        task.finished <- true;
+        match exn with Cancelled -> () | exn -> raise exn);
+    effc =
+      (fun (type a) (eff : a Effect.t) ->
+        match eff with
+        | Yield ->
+            Some
+              (fun (k : (a, unit) continuation) ->
+                task.resume <-
+                  (fun () ->
+                    if task.cancelled then
+                      discontinue k Cancelled
+                    else
+                      continue k ());
+                Queue.push task ready)
+        | _ ->
+            None);
+  }
+
+let start inbox body =
+  let task = { resume = ignore; cancelled = false; finished = false } in
+  (* Waits for room rather than dropping a message, as the last one is the
+     result *)
+  let rec report msg =
+    if not (Inbox.post inbox msg) then
+      match !current with
+      | Some running when running == task ->
+          Effect.perform Yield;
+          report msg
+      | _ ->
+          ()
+  in
+  task.resume <-
+    (fun () ->
+      if task.cancelled then
+        task.finished <- true
+      else
+        Effect.Deep.match_with
+          (fun () -> report (body report))
+          () (handler task));
+  Queue.push task ready;
+  Wakeup.wake ();
+  task
+
+let cancel t = t.cancelled <- true
+
+let is_running t = not t.finished
+
+let pending () = not (Queue.is_empty ready)
+
+let run ~now ~deadline =
+  let rec resume_next left =
+    if left > 0 then
+      match Queue.take_opt ready with
+      | Some task ->
+          (* Time a task leaves unused goes to the ones after it *)
+          let start = now () in
+          let slice_end = start +. ((deadline -. start) /. float_of_int left) in
+          slice_over := (fun () -> now () >= slice_end);
+          current := Some task;
+          (match task.resume () with
+          | () ->
+              current := None
+          | exception exn ->
+              current := None;
+              raise exn);
+          resume_next (left - 1)
+      | None ->
+          ()
+  in
+  resume_next (Queue.length ready);
+  pending ()
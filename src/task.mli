@@ -0,0 +1,71 @@
+(** Long-running work on the main loop, spread over frames.
+
+    A task is a function started from [update] that calls {!yield} every so
+    often, such as every few thousand rows of a sort. The runtime runs tasks
+    in the time left over at the end of each frame, after input, rendering
+    and background messages; {!yield} hands control back once the task's share
+    of that time is used up, and the task carries on from there next frame.
+    The UI stays responsive however long the whole job takes.
+
+    Tasks run on the main loop, so unlike work on another domain they may
+    read and mutate anything [update] can, such as a {!Text_buffer.t}. They
+    must not rely on it staying unchanged across a {!yield}, as [update] runs
+    in between.
+
+    A task reports back through an {!Inbox.t}: progress messages while it
+    runs and a final message with its result. *)
+
+type t
+
+exception Cancelled
+(** Raised by {!yield} in a task that was cancelled, so it unwinds and runs
+    its [Fun.protect] finalizers. The runtime catches it. *)
+
+val start : 'msg Inbox.t -> (('msg -> unit) -> 'msg) -> t
+(** [start inbox body] queues [body report] to run from the end of the
+    current frame on. [body] posts progress to [inbox] with [report], which
+    may yield to wait for room when [inbox] is full, and its result is posted
+    as the last message. An exception other than {!Cancelled} escapes the
+    runtime, as it would from [update].
+
+    Example:
+    {[
+      | Msg.Sort column ->
+          let rows = Array.copy model.rows in
+          let task =
+            Task.start tasks (fun report ->
+                merge_sort rows ~compare:(compare_by column)
+                  ~every:10_000 ~progress:(fun done_ ->
+                    Task.yield ();
+                    report (Msg.Sorting done_));
+                Msg.Sorted rows)
+          in
+          ({ model with sorting = Some task }, Cmd.none)
+    ]}
+    with [Sub.on_inbox tasks] among the subscriptions. *)
+
+val yield : unit -> unit
+(** [yield ()] suspends the current task until the next frame if its time for
+    this frame is up, and returns at once otherwise, so it is cheap to call
+    often. Outside of a task, it does nothing.
+
+    @raise Cancelled if the task was cancelled *)
+
+val cancel : t -> unit
+(** [cancel t] stops [t] at its next {!yield}, or before it starts. It posts
+    no further messages. *)
+
+val is_running : t -> bool
+(** [is_running t] is [false] once [t] has returned, raised or been
+    cancelled. *)
+
+(** {2 Internal API for the Runtime} *)
+
+val pending : unit -> bool
+(** Whether any task is waiting to run *)
+
+val run : now:(unit -> float) -> deadline:float -> bool
+(** [run ~now ~deadline] resumes each waiting task once, sharing the time
+    until [deadline] between them, with [now] as the clock in milliseconds.
+    Each task runs at least until its first {!yield}. Returns whether any
+    task is still waiting. *)
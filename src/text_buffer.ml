@@ -0,0 +1,376 @@
+(* A piece table: the document is a sequence of pieces, each a span of either
+   the original text or of the append-only buffer of inserted text. Edits
+   split and drop pieces without copying text. Line breaks are counted per
+   piece from sorted break offsets of both sources, and each piece records
+   its document offset and the breaks before it, so line lookups are binary
+   searches. *)
+
+type source =
+  | Original
+  | Added
+
+type piece = {
+  source : source;
+  start : int;  (* Offset in the source *)
+  length : int;  (* Never zero *)
+  breaks : int;  (* Line breaks in the span *)
+}
+
+type edit =
+  | Insert of { at : int; text : string }
+  | Delete of { at : int; length : int }
+
+type t = {
+  original : string;
+  original_breaks : int array;
+  mutable added : Bytes.t;
+  mutable added_length : int;
+  mutable added_breaks : int array;
+  mutable added_break_count : int;
+  mutable pieces : piece array;
+  mutable piece_count : int;
+  (* Document offset of each piece, and the line breaks before it *)
+  mutable piece_offsets : int array;
+  mutable piece_lines : int array;
+  mutable length : int;
+  mutable breaks : int;
+  mutable version : int;
+}
+
+let no_piece = { source = Original; start = 0; length = 0; breaks = 0 }
+
+let breaks_of_string s =
+  let count = ref 0 in
+  String.iter (fun c -> if c = '\n' then incr count) s;
+  let breaks = Array.make !count 0 in
+  let next = ref 0 in
+  String.iteri
+    (fun i c ->
+      if c = '\n' then begin
+        breaks.(!next) <- i;
+        incr next
+      end)
+    s;
+  breaks
+
+(* Number of the first [count] entries of the sorted [breaks] below
+   [offset] *)
+let count_below breaks count offset =
+  let rec search low high =
+    if low >= high then
+      low
+    else
+      let mid = (low + high) / 2 in
+      if breaks.(mid) < offset then
+        search (mid + 1) high
+      else
+        search low mid
+  in
+  search 0 count
+
+(* Line breaks of [source] in [start, stop) *)
+let breaks_between t source ~start ~stop =
+  match source with
+  | Original ->
+      let count = Array.length t.original_breaks in
+      count_below t.original_breaks count stop
+      - count_below t.original_breaks count start
+  | Added ->
+      let count = t.added_break_count in
+      count_below t.added_breaks count stop
+      - count_below t.added_breaks count start
+
+let make_piece t source ~start ~length =
+  {
+    source;
+    start;
+    length;
+    breaks = breaks_between t source ~start ~stop:(start + length);
+  }
+
+let of_string original =
+  let t =
+    {
+      original;
+      original_breaks = breaks_of_string original;
+      added = Bytes.create 0;
+      added_length = 0;
+      added_breaks = [||];
+      added_break_count = 0;
+      pieces = [||];
+      piece_count = 0;
+      piece_offsets = [||];
+      piece_lines = [||];
+      length = 0;
+      breaks = 0;
+      version = 0;
+    }
+  in
+  if original <> "" then begin
+    let piece =
+      make_piece t Original ~start:0 ~length:(String.length original)
+    in
+    t.pieces <- [| piece |];
+    t.piece_count <- 1;
+    t.piece_offsets <- [| 0 |];
+    t.piece_lines <- [| 0 |];
+    t.length <- piece.length;
+    t.breaks <- piece.breaks
+  end;
+  t
+
+let create () = of_string ""
+
+let length t = t.length
+
+let line_count t = t.breaks + 1
+
+let version t = t.version
+
+(* Recomputes offsets and line counts from piece [from] on *)
+let reindex t ~from =
+  let offset = ref 0 and lines = ref 0 in
+  if from > 0 then begin
+    let previous = t.pieces.(from - 1) in
+    offset := t.piece_offsets.(from - 1) + previous.length;
+    lines := t.piece_lines.(from - 1) + previous.breaks
+  end;
+  for i = from to t.piece_count - 1 do
+    t.piece_offsets.(i) <- !offset;
+    t.piece_lines.(i) <- !lines;
+    offset := !offset + t.pieces.(i).length;
+    lines := !lines + t.pieces.(i).breaks
+  done;
+  t.length <- !offset;
+  t.breaks <- !lines;
+  t.version <- t.version + 1
+
+let reserve_pieces t needed =
+  let capacity = Array.length t.pieces in
+  if needed > capacity then begin
+    let capacity = max needed (max 16 (capacity * 2)) in
+    let grow_ints ints =
+      let grown = Array.make capacity 0 in
+      Array.blit ints 0 grown 0 t.piece_count;
+      grown
+    in
+    let pieces = Array.make capacity no_piece in
+    Array.blit t.pieces 0 pieces 0 t.piece_count;
+    t.pieces <- pieces;
+    t.piece_offsets <- grow_ints t.piece_offsets;
+    t.piece_lines <- grow_ints t.piece_lines
+  end
+
+(* Replaces [removed] pieces from [first] on with [replacement] *)
+let splice t ~first ~removed replacement =
+  let inserted = Array.length replacement in
+  let count = t.piece_count - removed + inserted in
+  reserve_pieces t count;
+  Array.blit t.pieces (first + removed) t.pieces (first + inserted)
+    (t.piece_count - first - removed);
+  Array.blit replacement 0 t.pieces first inserted;
+  if count < t.piece_count then
+    Array.fill t.pieces count (t.piece_count - count) no_piece;
+  t.piece_count <- count;
+  reindex t ~from:first
+
+(* Appends [text] to the added buffer and returns where it starts *)
+let append_added t text =
+  let start = t.added_length in
+  let length = String.length text in
+  if start + length > Bytes.length t.added then begin
+    let capacity = max (start + length) (max 4096 (2 * Bytes.length t.added)) in
+    let added = Bytes.create capacity in
+    Bytes.blit t.added 0 added 0 start;
+    t.added <- added
+  end;
+  Bytes.blit_string text 0 t.added start length;
+  t.added_length <- start + length;
+  String.iteri
+    (fun i c ->
+      if c = '\n' then begin
+        if t.added_break_count = Array.length t.added_breaks then begin
+          let breaks = Array.make (max 64 (2 * t.added_break_count)) 0 in
+          Array.blit t.added_breaks 0 breaks 0 t.added_break_count;
+          t.added_breaks <- breaks
+        end;
+        t.added_breaks.(t.added_break_count) <- start + i;
+        t.added_break_count <- t.added_break_count + 1
+      end)
+    text;
+  start
+
+(* Index of the piece holding [offset], or [piece_count] at the end *)
+let find_piece t offset =
+  if offset >= t.length then
+    t.piece_count
+  else
+    let rec search low high =
+      if high - low <= 1 then
+        low
+      else
+        let mid = (low + high) / 2 in
+        if t.piece_offsets.(mid) <= offset then
+          search mid high
+        else
+          search low mid
+    in
+    search 0 t.piece_count
+
+let check_range name t ~at ~length =
+  if at < 0 || length < 0 || at + length > t.length then
+    invalid_arg (name ^ ": out of bounds")
+
+let insert t ~at text =
+  check_range "Text_buffer.insert" t ~at ~length:0;
+  if text <> "" then begin
+    let start = append_added t text in
+    let length = String.length text in
+    let i = find_piece t at in
+    if i = t.piece_count || t.piece_offsets.(i) = at then begin
+      (* Typing appends to the piece it just added rather than adding one
+         piece per keystroke *)
+      let previous = i - 1 in
+      if
+        previous >= 0
+        && t.pieces.(previous).source = Added
+        && t.pieces.(previous).start + t.pieces.(previous).length = start
+      then begin
+        let piece = t.pieces.(previous) in
+        t.pieces.(previous) <-
+          make_piece t Added ~start:piece.start ~length:(piece.length + length);
+        reindex t ~from:previous
+      end
+      else
+        splice t ~first:i ~removed:0 [| make_piece t Added ~start ~length |]
+    end
+    else begin
+      let piece = t.pieces.(i) in
+      let left = at - t.piece_offsets.(i) in
+      splice t ~first:i ~removed:1
+        [|
+          make_piece t piece.source ~start:piece.start ~length:left;
+          make_piece t Added ~start ~length;
+          make_piece t piece.source ~start:(piece.start + left)
+            ~length:(piece.length - left);
+        |]
+    end
+  end
+
+let delete t ~at ~length =
+  check_range "Text_buffer.delete" t ~at ~length;
+  if length > 0 then begin
+    let stop = at + length in
+    let first = find_piece t at in
+    let last = find_piece t (stop - 1) in
+    let first_piece = t.pieces.(first) and last_piece = t.pieces.(last) in
+    let kept_left = at - t.piece_offsets.(first) in
+    let kept_right = t.piece_offsets.(last) + last_piece.length - stop in
+    let left =
+      if kept_left > 0 then
+        [ make_piece t first_piece.source ~start:first_piece.start
+            ~length:kept_left ]
+      else
+        []
+    in
+    let right =
+      if kept_right > 0 then
+        [ make_piece t last_piece.source
+            ~start:(last_piece.start + last_piece.length - kept_right)
+            ~length:kept_right ]
+      else
+        []
+    in
+    splice t ~first ~removed:(last - first + 1) (Array.of_list (left @ right))
+  end
+
+let apply t = function
+  | Insert { at; text } ->
+      insert t ~at text
+  | Delete { at; length } ->
+      delete t ~at ~length
+
+let sub t ~at ~length =
+  check_range "Text_buffer.sub" t ~at ~length;
+  let result = Bytes.create length in
+  let rec copy i written =
+    if written < length then begin
+      let piece = t.pieces.(i) in
+      (* Only the first piece is entered part way *)
+      let skip = max 0 (at + written - t.piece_offsets.(i)) in
+      let count = min (piece.length - skip) (length - written) in
+      (match piece.source with
+      | Original ->
+          Bytes.blit_string t.original (piece.start + skip) result written
+            count
+      | Added ->
+          Bytes.blit t.added (piece.start + skip) result written count);
+      copy (i + 1) (written + count)
+    end
+  in
+  if length > 0 then copy (find_piece t at) 0;
+  Bytes.unsafe_to_string result
+
+let get t offset =
+  check_range "Text_buffer.get" t ~at:offset ~length:1;
+  let i = find_piece t offset in
+  let piece = t.pieces.(i) in
+  let index = piece.start + offset - t.piece_offsets.(i) in
+  match piece.source with
+  | Original ->
+      t.original.[index]
+  | Added ->
+      Bytes.get t.added index
+
+let to_string t = sub t ~at:0 ~length:t.length
+
+let line_start t line =
+  if line < 0 || line > t.breaks then
+    invalid_arg "Text_buffer.line_start: no such line";
+  if line = 0 then
+    0
+  else
+    (* The piece holding the break that ends line [line - 1] *)
+    let rec search low high =
+      if low >= high then
+        low
+      else
+        let mid = (low + high) / 2 in
+        if t.piece_lines.(mid) + t.pieces.(mid).breaks >= line then
+          search low mid
+        else
+          search (mid + 1) high
+    in
+    let i = search 0 t.piece_count in
+    let piece = t.pieces.(i) in
+    let breaks, count =
+      match piece.source with
+      | Original ->
+          (t.original_breaks, Array.length t.original_breaks)
+      | Added ->
+          (t.added_breaks, t.added_break_count)
+    in
+    let first_break = count_below breaks count piece.start in
+    let break = breaks.(first_break + line - t.piece_lines.(i) - 1) in
+    t.piece_offsets.(i) + break - piece.start + 1
+
+let line_end t line =
+  if line = t.breaks then
+    t.length
+  else
+    line_start t (line + 1) - 1
+
+let line t line =
+  let start = line_start t line in
+  sub t ~at:start ~length:(line_end t line - start)
+
+let line_of_offset t offset =
+  check_range "Text_buffer.line_of_offset" t ~at:offset ~length:0;
+  let i = find_piece t offset in
+  if i = t.piece_count then
+    t.breaks
+  else
+    let piece = t.pieces.(i) in
+    t.piece_lines.(i)
+    + breaks_between t piece.source ~start:piece.start
+        ~stop:(piece.start + offset - t.piece_offsets.(i))
@@ -0,0 +1,70 @@
+(** Editable text for {!Mlui.editor}, sized for multi-megabyte documents.
+
+    A buffer is a piece table over the original text and an append-only
+    buffer of inserted text, so an edit costs time in the number of edits
+    made so far rather than in the size of the document, and copies nothing
+    but the inserted text. Line starts are kept up to date with every edit,
+    so looking up a line or the line of an offset is a binary search.
+
+    Offsets count bytes. Lines are separated by ['\n'], which belongs to the
+    line it ends.
+
+    A buffer is mutable; keep it next to the model rather than in it, and
+    edit it from [update]. *)
+
+type t
+
+(** A change to a buffer, small enough to pass around as a message *)
+type edit =
+  | Insert of { at : int; text : string }
+  | Delete of { at : int; length : int }
+
+val create : unit -> t
+(** [create ()] is an empty buffer. *)
+
+val of_string : string -> t
+(** [of_string text] is a buffer holding [text], which is not copied. *)
+
+val length : t -> int
+(** Length of the document in bytes *)
+
+val line_count : t -> int
+(** Number of lines, at least one *)
+
+val insert : t -> at:int -> string -> unit
+(** [insert t ~at text] inserts [text] before offset [at].
+
+    @raise Invalid_argument if [at] is not within [0, length t] *)
+
+val delete : t -> at:int -> length:int -> unit
+(** [delete t ~at ~length] removes [length] bytes from offset [at].
+
+    @raise Invalid_argument if the range is not within the document *)
+
+val apply : t -> edit -> unit
+(** [apply t edit] performs [edit] with {!insert} or {!delete}. *)
+
+val get : t -> int -> char
+(** [get t offset] is the byte at [offset]. *)
+
+val sub : t -> at:int -> length:int -> string
+(** [sub t ~at ~length] is a copy of [length] bytes from offset [at]. *)
+
+val to_string : t -> string
+(** A copy of the whole document. Avoid it on large documents; use {!line} or
+    {!sub} for the parts you need. *)
+
+val line : t -> int -> string
+(** [line t n] is line [n], counting from [0], without its line break. *)
+
+val line_start : t -> int -> int
+(** Offset of the first byte of a line *)
+
+val line_end : t -> int -> int
+(** Offset of the line break ending a line, or {!length} for the last one *)
+
+val line_of_offset : t -> int -> int
+(** [line_of_offset t offset] is the line holding [offset]. *)
+
+val version : t -> int
+(** [version t] changes with every edit. *)
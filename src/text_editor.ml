@@ -0,0 +1,139 @@
+type t = {
+  buffer : Text_buffer.t;
+  cursor : int;
+  first_line : int;
+  page_lines : int;
+}
+
+type msg =
+  | Input of string
+  | Key of string
+  | Scroll of int
+  | Move_to of int
+
+let create ?(page_lines = 30) buffer =
+  { buffer; cursor = 0; first_line = 0; page_lines = max 1 page_lines }
+
+let buffer t = t.buffer
+
+let cursor t = t.cursor
+
+let first_line t = t.first_line
+
+(* Shared with layout, which draws one line every [line_height] *)
+let line_height ~font_size = font_size *. 1.25
+
+let line_at t ~font_size ~y =
+  let line = t.first_line + int_of_float (y /. line_height ~font_size) in
+  max 0 (min (Text_buffer.line_count t.buffer - 1) line)
+
+let cursor_position t =
+  let line = Text_buffer.line_of_offset t.buffer t.cursor in
+  (line, t.cursor - Text_buffer.line_start t.buffer line)
+
+let is_continuation_byte c = Char.code c land 0xC0 = 0x80
+
+(* Cursor movement steps over whole UTF-8 sequences *)
+let rec previous_boundary buffer offset =
+  if offset <= 0 then
+    0
+  else if is_continuation_byte (Text_buffer.get buffer (offset - 1)) then
+    previous_boundary buffer (offset - 1)
+  else
+    offset - 1
+
+let next_boundary buffer offset =
+  let length = Text_buffer.length buffer in
+  let rec skip offset =
+    if offset < length && is_continuation_byte (Text_buffer.get buffer offset)
+    then
+      skip (offset + 1)
+    else
+      offset
+  in
+  if offset >= length then
+    length
+  else
+    skip (offset + 1)
+
+(* [offset], or the start of the character it falls in when it is inside a
+   UTF-8 sequence *)
+let snap_to_boundary buffer offset =
+  if
+    offset < Text_buffer.length buffer
+    && is_continuation_byte (Text_buffer.get buffer offset)
+  then
+    previous_boundary buffer offset
+  else
+    offset
+
+(* The offset [lines] lines away, at the same byte column or the end of the
+   line when it is shorter, on a character boundary *)
+let move_lines t lines =
+  let line, column = cursor_position t in
+  let target =
+    max 0 (min (Text_buffer.line_count t.buffer - 1) (line + lines))
+  in
+  let start = Text_buffer.line_start t.buffer target in
+  snap_to_boundary t.buffer
+    (start + min column (Text_buffer.line_end t.buffer target - start))
+
+let clamp_first_line t first_line =
+  max 0 (min (Text_buffer.line_count t.buffer - 1) first_line)
+
+let scroll_to_cursor t =
+  let line = Text_buffer.line_of_offset t.buffer t.cursor in
+  if line < t.first_line then
+    { t with first_line = line }
+  else if line >= t.first_line + t.page_lines then
+    { t with first_line = line - t.page_lines + 1 }
+  else
+    t
+
+let update t msg =
+  let buffer = t.buffer in
+  let edit_at edit cursor =
+    Text_buffer.apply buffer edit;
+    (scroll_to_cursor { t with cursor }, Some edit)
+  in
+  let move cursor = (scroll_to_cursor { t with cursor }, None) in
+  match msg with
+  | Input text ->
+      edit_at
+        (Text_buffer.Insert { at = t.cursor; text })
+        (t.cursor + String.length text)
+  | Key ("Return" | "Keypad Enter") ->
+      edit_at (Text_buffer.Insert { at = t.cursor; text = "\n" }) (t.cursor + 1)
+  | Key "Backspace" when t.cursor > 0 ->
+      let at = previous_boundary buffer t.cursor in
+      edit_at (Text_buffer.Delete { at; length = t.cursor - at }) at
+  | Key "Delete" when t.cursor < Text_buffer.length buffer ->
+      let length = next_boundary buffer t.cursor - t.cursor in
+      edit_at (Text_buffer.Delete { at = t.cursor; length }) t.cursor
+  | Key "Left" ->
+      move (previous_boundary buffer t.cursor)
+  | Key "Right" ->
+      move (next_boundary buffer t.cursor)
+  | Key "Up" ->
+      move (move_lines t (-1))
+  | Key "Down" ->
+      move (move_lines t 1)
+  | Key "PageUp" ->
+      move (move_lines t (-t.page_lines))
+  | Key "PageDown" ->
+      move (move_lines t t.page_lines)
+  | Key "Home" ->
+      let line, _ = cursor_position t in
+      move (Text_buffer.line_start buffer line)
+  | Key "End" ->
+      let line, _ = cursor_position t in
+      move (Text_buffer.line_end buffer line)
+  | Key _ ->
+      (t, None)
+  | Scroll lines ->
+      ({ t with first_line = clamp_first_line t (t.first_line + lines) }, None)
+  | Move_to offset ->
+      (* Offsets from pointer hits can land inside a UTF-8 sequence *)
+      move
+        (snap_to_boundary buffer
+           (max 0 (min (Text_buffer.length buffer) offset)))
@@ -0,0 +1,50 @@
+(** State of an {!Mlui.editor}: a {!Text_buffer.t} with a cursor and a
+    scroll position.
+
+    Editors are values: {!update} returns a new one, which goes in the model.
+    The buffer they share is edited in place, so only the latest editor of a
+    buffer is meaningful.
+
+    Keystrokes come in as small messages from subscriptions, and {!update}
+    turns each into at most one {!Text_buffer.edit}, which it applies and
+    returns, so the app can record or forward edits without ever copying the
+    document. *)
+
+type t
+
+type msg =
+  | Input of string  (** Typed text, from {!Mlui.Sub.on_text_input} *)
+  | Key of string  (** A key name, from {!Mlui.Sub.on_key_down} *)
+  | Scroll of int  (** Scroll by a number of lines *)
+  | Move_to of int
+      (** Put the cursor at an offset, or at the start of the character it
+          falls in *)
+
+val create : ?page_lines:int -> Text_buffer.t -> t
+(** [create buffer] edits [buffer], with the cursor at the start. Cursor
+    movement keeps the cursor within [page_lines] lines (default [30]) of the
+    first line shown; pass the number of lines the editor's box holds. *)
+
+val update : t -> msg -> t * Text_buffer.edit option
+(** [update t msg] handles typed text and the Return, Backspace, Delete,
+    arrow, Home, End, PageUp and PageDown keys, and scrolls to keep the cursor
+    in view. Returns the edit made to the buffer, if any. Other keys are
+    ignored. *)
+
+val buffer : t -> Text_buffer.t
+
+val cursor : t -> int
+(** Offset of the cursor *)
+
+val cursor_position : t -> int * int
+(** Line of the cursor and its byte offset within the line *)
+
+val first_line : t -> int
+(** First line shown *)
+
+val line_height : font_size:float -> float
+(** Height of a line of text at [font_size] *)
+
+val line_at : t -> font_size:float -> y:float -> int
+(** [line_at t ~font_size ~y] is the line shown at [y] from the top of the
+    editor's box, such as in a mouse handler. *)
@@ -1,3 +1,4 @@
 include Types
 
 let run = Runtime.run
+let run_windows = Runtime.run_windows
@@ -28,39 +28,59 @@ type primitive =
     }
   | Path of { points : (float * float) list; style : primitive_style }
 
+(* Cached layout and primitives of a node built with [static] *)
+type 'msg static_node
+
+(* Event handlers of a node, given to the constructors below *)
+type 'msg handlers
+
 (* Interactive UI nodes - can have keys, event handlers, bounds *)
 type 'msg node =
   | View : {
       style : Style.t;
-      children : 'msg node list;
+      children : 'msg node array;
       key : string option;
-      on_click : (unit -> 'msg option) option;
-      on_mouse_down : (int * int -> 'msg option) option;
-      on_mouse_up : (int * int -> 'msg option) option;
-      on_mouse_move : (int * int -> 'msg option) option;
-      on_mouse_enter : (int * int -> 'msg option) option;
-      on_mouse_leave : (int * int -> 'msg option) option;
+      handlers : 'msg handlers;
     }
       -> 'msg node
   | Text : {
       content : string;
       style : Style.t;
       key : string option;
-      on_click : (unit -> 'msg option) option;
+      handlers : 'msg handlers;
     }
       -> 'msg node
   | Canvas : {
       primitives : primitive list;
       style : Style.t;
       key : string option;
-      on_click : (unit -> 'msg option) option;
-      on_mouse_down : (int * int -> 'msg option) option;
-      on_mouse_up : (int * int -> 'msg option) option;
-      on_mouse_move : (int * int -> 'msg option) option;
-      on_mouse_enter : (int * int -> 'msg option) option;
-      on_mouse_leave : (int * int -> 'msg option) option;
+      handlers : 'msg handlers;
+    }
+      -> 'msg node
+  | Chart : {
+      series : Series.t;
+      style : Style.t;
+      key : string option;
+      color : Color.t;
+      line_width : float;
+      y_range : (float * float) option;
+    }
+      -> 'msg node
+  | Raster : {
+      raster : Raster.t;
+      style : Style.t;
+      key : string option;
+      handlers : 'msg handlers;
+    }
+      -> 'msg node
+  | Editor : {
+      editor : Text_editor.t;
+      style : Style.t;
+      key : string option;
+      handlers : 'msg handlers;
     }
       -> 'msg node
+  | Static : 'msg static_node -> 'msg node
   | Empty : 'msg node
 
 (* Map messages from one type to another *)
@@ -69,44 +89,153 @@ val map_msg : ('a -> 'b) -> 'a node -> 'b node
 (* Hit-testing for interactive nodes only *)
 type path = int list
 
-type 'msg node_with_bounds = {
-  node : 'msg node;
-  bounds : bounds;
-  children : 'msg node_with_bounds list;
-  path : path;
-}
-
 (* Interactive UI node constructors *)
 val view :
   ?style:Style.t ->
   ?key:string ->
   ?on_click:(unit -> 'msg option) ->
+  ?on_click_msg:'msg ->
+  ?on_click_with:('a -> 'msg option) * 'a ->
   ?on_mouse_down:(int * int -> 'msg option) ->
+  ?on_mouse_down_msg:'msg ->
+  ?on_mouse_down_with:('b -> int * int -> 'msg option) * 'b ->
   ?on_mouse_up:(int * int -> 'msg option) ->
+  ?on_mouse_up_msg:'msg ->
+  ?on_mouse_up_with:('c -> int * int -> 'msg option) * 'c ->
   ?on_mouse_move:(int * int -> 'msg option) ->
+  ?on_mouse_move_msg:'msg ->
+  ?on_mouse_move_with:('d -> int * int -> 'msg option) * 'd ->
   ?on_mouse_enter:(int * int -> 'msg option) ->
+  ?on_mouse_enter_msg:'msg ->
+  ?on_mouse_enter_with:('e -> int * int -> 'msg option) * 'e ->
   ?on_mouse_leave:(int * int -> 'msg option) ->
+  ?on_mouse_leave_msg:'msg ->
+  ?on_mouse_leave_with:('f -> int * int -> 'msg option) * 'f ->
   'msg node list ->
   'msg node
+val view_array :
+  ?style:Style.t ->
+  ?key:string ->
+  ?on_click:(unit -> 'msg option) ->
+  ?on_click_msg:'msg ->
+  ?on_click_with:('a -> 'msg option) * 'a ->
+  ?on_mouse_down:(int * int -> 'msg option) ->
+  ?on_mouse_down_msg:'msg ->
+  ?on_mouse_down_with:('b -> int * int -> 'msg option) * 'b ->
+  ?on_mouse_up:(int * int -> 'msg option) ->
+  ?on_mouse_up_msg:'msg ->
+  ?on_mouse_up_with:('c -> int * int -> 'msg option) * 'c ->
+  ?on_mouse_move:(int * int -> 'msg option) ->
+  ?on_mouse_move_msg:'msg ->
+  ?on_mouse_move_with:('d -> int * int -> 'msg option) * 'd ->
+  ?on_mouse_enter:(int * int -> 'msg option) ->
+  ?on_mouse_enter_msg:'msg ->
+  ?on_mouse_enter_with:('e -> int * int -> 'msg option) * 'e ->
+  ?on_mouse_leave:(int * int -> 'msg option) ->
+  ?on_mouse_leave_msg:'msg ->
+  ?on_mouse_leave_with:('f -> int * int -> 'msg option) * 'f ->
+  'msg node array ->
+  'msg node
 val text :
   ?style:Style.t ->
   ?key:string ->
   ?on_click:(unit -> 'msg option) ->
+  ?on_click_msg:'msg ->
+  ?on_click_with:('a -> 'msg option) * 'a ->
   string ->
   'msg node
 val canvas :
   ?style:Style.t ->
   ?key:string ->
   ?on_click:(unit -> 'msg option) ->
+  ?on_click_msg:'msg ->
+  ?on_click_with:('a -> 'msg option) * 'a ->
   ?on_mouse_down:(int * int -> 'msg option) ->
+  ?on_mouse_down_msg:'msg ->
+  ?on_mouse_down_with:('b -> int * int -> 'msg option) * 'b ->
   ?on_mouse_up:(int * int -> 'msg option) ->
+  ?on_mouse_up_msg:'msg ->
+  ?on_mouse_up_with:('c -> int * int -> 'msg option) * 'c ->
   ?on_mouse_move:(int * int -> 'msg option) ->
+  ?on_mouse_move_msg:'msg ->
+  ?on_mouse_move_with:('d -> int * int -> 'msg option) * 'd ->
   ?on_mouse_enter:(int * int -> 'msg option) ->
+  ?on_mouse_enter_msg:'msg ->
+  ?on_mouse_enter_with:('e -> int * int -> 'msg option) * 'e ->
   ?on_mouse_leave:(int * int -> 'msg option) ->
+  ?on_mouse_leave_msg:'msg ->
+  ?on_mouse_leave_with:('f -> int * int -> 'msg option) * 'f ->
   primitive list ->
   'msg node
+val chart :
+  ?style:Style.t ->
+  ?key:string ->
+  ?color:Color.t ->
+  ?line_width:float ->
+  ?y_range:float * float ->
+  Series.t ->
+  'msg node
+val raster :
+  ?style:Style.t ->
+  ?key:string ->
+  ?on_click:(unit -> 'msg option) ->
+  ?on_click_msg:'msg ->
+  ?on_click_with:('a -> 'msg option) * 'a ->
+  ?on_mouse_down:(int * int -> 'msg option) ->
+  ?on_mouse_down_msg:'msg ->
+  ?on_mouse_down_with:('b -> int * int -> 'msg option) * 'b ->
+  ?on_mouse_up:(int * int -> 'msg option) ->
+  ?on_mouse_up_msg:'msg ->
+  ?on_mouse_up_with:('c -> int * int -> 'msg option) * 'c ->
+  ?on_mouse_move:(int * int -> 'msg option) ->
+  ?on_mouse_move_msg:'msg ->
+  ?on_mouse_move_with:('d -> int * int -> 'msg option) * 'd ->
+  ?on_mouse_enter:(int * int -> 'msg option) ->
+  ?on_mouse_enter_msg:'msg ->
+  ?on_mouse_enter_with:('e -> int * int -> 'msg option) * 'e ->
+  ?on_mouse_leave:(int * int -> 'msg option) ->
+  ?on_mouse_leave_msg:'msg ->
+  ?on_mouse_leave_with:('f -> int * int -> 'msg option) * 'f ->
+  Raster.t ->
+  'msg node
+val editor :
+  ?style:Style.t ->
+  ?key:string ->
+  ?on_click:(unit -> 'msg option) ->
+  ?on_click_msg:'msg ->
+  ?on_click_with:('a -> 'msg option) * 'a ->
+  ?on_mouse_down:(int * int -> 'msg option) ->
+  ?on_mouse_down_msg:'msg ->
+  ?on_mouse_down_with:('b -> int * int -> 'msg option) * 'b ->
+  ?on_mouse_up:(int * int -> 'msg option) ->
+  ?on_mouse_up_msg:'msg ->
+  ?on_mouse_up_with:('c -> int * int -> 'msg option) * 'c ->
+  ?on_mouse_move:(int * int -> 'msg option) ->
+  ?on_mouse_move_msg:'msg ->
+  ?on_mouse_move_with:('d -> int * int -> 'msg option) * 'd ->
+  ?on_mouse_enter:(int * int -> 'msg option) ->
+  ?on_mouse_enter_msg:'msg ->
+  ?on_mouse_enter_with:('e -> int * int -> 'msg option) * 'e ->
+  ?on_mouse_leave:(int * int -> 'msg option) ->
+  ?on_mouse_leave_msg:'msg ->
+  ?on_mouse_leave_with:('f -> int * int -> 'msg option) * 'f ->
+  Text_editor.t ->
+  'msg node
 val empty : 'msg node
 
+(* Subtree built, laid out once per size and converted to primitives once;
+   hoist it. [width] and [height] pin its box. *)
+val static : ?width:int -> ?height:int -> (unit -> 'msg node) -> 'msg node
+
+(* Subtree rebuilt from its input at most [fps] times a second *)
+val throttled :
+  fps:float ->
+  ?width:int ->
+  ?height:int ->
+  ('a -> 'msg node) ->
+  'a ->
+  'msg node
+
 (* Primitive constructors for canvas content *)
 val rectangle :
   x:float ->
@@ -132,6 +261,10 @@ val fill_and_stroke : Color.t -> Color.t -> float -> primitive_style
 val run :
   window:Window.t ->
   ?subscriptions:('model -> 'msg Subscription.t) ->
+  ?quality:Quality.config ->
+  ?msg_name:('msg -> string) ->
+  ?slow_update_ms:float ->
+  ?model_sample_ms:float ->
   init:'model ->
   update:('msg -> 'model -> 'model * Cmd.t) ->
   view:('model -> 'msg node) ->
@@ -149,3 +282,18 @@ val run :
           ]
           Mlui.run ~window ~subscriptions ~init ~update ~view ()
     ]} *)
+
+val run_windows :
+  windows:(Window.t * ('model -> 'msg node)) list ->
+  ?subscriptions:('model -> 'msg Subscription.t) ->
+  ?quality:Quality.config ->
+  ?msg_name:('msg -> string) ->
+  ?slow_update_ms:float ->
+  ?model_sample_ms:float ->
+  init:'model ->
+  update:('msg -> 'model -> 'model * Cmd.t) ->
+  unit ->
+  (unit, [ `Msg of string ]) result
+(** Run one application across several windows. Each window has its own view
+    and hit-testing, while the model, update loop and GPU resources are
+    shared. *)
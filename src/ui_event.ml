@@ -12,3 +12,4 @@ type t =
   | MouseLeave of { x : int; y : int }
   | KeyUp of string
   | KeyDown of string
+  | TextInput of string (* UTF-8 text typed, after keyboard layout and IME *)
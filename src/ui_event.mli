@@ -11,4 +11,7 @@ type t =
   | MouseEnter of { x : int; y : int }
   | MouseLeave of { x : int; y : int }
   | KeyUp of string
-  | KeyDown of string  (** Event types that can occur in the UI *)
+  | KeyDown of string
+  | TextInput of string
+      (** UTF-8 text typed, after keyboard layout and input method *)
+(** Event types that can occur in the UI *)
@@ -0,0 +1,65 @@
+(** Waking the event loop from outside of it *)
+
+open Tsdl
+
+(* SDL user event type, or -1 before the runtime registered it *)
+let event_type = Atomic.make (-1)
+
+(* Set while a wakeup event sits in the SDL queue *)
+let pending = Atomic.make false
+
+(* Earliest deadline in SDL ticks, max_int when none *)
+let deadline = Atomic.make max_int
+
+let init () =
+  (if Atomic.get event_type < 0 then
+     match Sdl.register_event () with
+     | Some user_type ->
+         Atomic.set event_type user_type
+     | None ->
+         Printf.eprintf "[Wakeup] Warning: no SDL user event available\n%!");
+  Atomic.set pending false
+
+let wake () =
+  let user_type = Atomic.get event_type in
+  if user_type >= 0 && Atomic.compare_and_set pending false true then begin
+    let event = Sdl.Event.create () in
+    Sdl.Event.(set event typ) user_type;
+    match Sdl.push_event event with
+    | Ok true ->
+        ()
+    | Ok false | Error _ ->
+        (* Filtered or queue full: let the next call try again *)
+        Atomic.set pending false
+  end
+
+let is_wakeup event =
+  let user_type = Atomic.get event_type in
+  if user_type >= 0 && Sdl.Event.(get event typ) = user_type then begin
+    Atomic.set pending false;
+    true
+  end
+  else
+    false
+
+let after ~ms =
+  let at = Int32.to_int (Sdl.get_ticks ()) + max 0 ms in
+  let rec lower () =
+    let current = Atomic.get deadline in
+    if at < current && not (Atomic.compare_and_set deadline current at) then
+      lower ()
+  in
+  lower ();
+  (* The loop may already be blocked without a timeout *)
+  wake ()
+
+let timeout_ms ~now =
+  let at = Atomic.get deadline in
+  if at = max_int then
+    None
+  else if at <= now then begin
+    ignore (Atomic.compare_and_set deadline at max_int);
+    Some 0
+  end
+  else
+    Some (at - now)
@@ -0,0 +1,41 @@
+(** Waking the event loop from outside of it.
+
+    When nothing is animating and no window needs a redraw, the runtime blocks
+    until the next SDL event instead of spinning. Anything that produces work
+    outside of SDL, such as native callbacks, worker domains or background
+    threads, must call {!wake} after making that work visible so the loop comes
+    around and picks it up within one frame.
+
+    All functions are safe to call from any domain or system thread. *)
+
+val wake : unit -> unit
+(** [wake ()] posts a wakeup event to the event loop. Wakeups coalesce: while
+    one is pending, further calls are free.
+
+    Example:
+    {[
+      let _ =
+        Domain.spawn (fun () ->
+            Atomic.set result (Some (compute ()));
+            Wakeup.wake ())
+    ]} *)
+
+val after : ms:int -> unit
+(** [after ~ms] makes sure the event loop comes around again in [ms]
+    milliseconds at the latest, even if no event arrives. The earliest pending
+    deadline wins. *)
+
+(** {2 Internal API for the Runtime} *)
+
+val init : unit -> unit
+(** [init ()] registers the wakeup event type. Called by the runtime once SDL
+    is initialised; wakeups before that are dropped. *)
+
+val is_wakeup : Tsdl.Sdl.event -> bool
+(** [is_wakeup event] tells whether [event] is a wakeup and, if so,
+    acknowledges it so the next {!wake} posts a new one. *)
+
+val timeout_ms : now:int -> int option
+(** [timeout_ms ~now] is the time left until the earliest deadline set with
+    {!after}, if any. A passed deadline is reported as [Some 0] once and then
+    cleared. *)
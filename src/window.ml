@@ -1,5 +1,23 @@
 (** Window configuration *)
 
-type t = { width : int; height : int; title : string }
+type t = {
+  width : int;
+  height : int;
+  title : string;
+  resize_throttle_ms : int;
+  stretch_on_resize : bool;
+  background_fps : int option;
+  dynamic_resolution : float option;
+}
 
-let make ~width ~height ?(title = "Mlui") () = { width; height; title }
+let make ~width ~height ?(title = "Mlui") ?(resize_throttle_ms = 50)
+    ?(stretch_on_resize = true) ?background_fps ?dynamic_resolution () =
+  {
+    width;
+    height;
+    title;
+    resize_throttle_ms;
+    stretch_on_resize;
+    background_fps;
+    dynamic_resolution;
+  }
@@ -1,8 +1,50 @@
 (** Window configuration *)
 
-type t = { width : int; height : int; title : string }
+type t = {
+  width : int;
+  height : int;
+  title : string;
+  resize_throttle_ms : int;
+      (** Minimum time between relayouts while the window is being resized *)
+  stretch_on_resize : bool;
+      (** Stretch the last frame between throttled relayouts *)
+  background_fps : int option;
+      (** Frame rate cap while the window is visible but unfocused *)
+  dynamic_resolution : float option;
+      (** Lowest render scale used automatically while animating *)
+}
 (** Window type with dimensions and title *)
 
-val make : width:int -> height:int -> ?title:string -> unit -> t
+val make :
+  width:int ->
+  height:int ->
+  ?title:string ->
+  ?resize_throttle_ms:int ->
+  ?stretch_on_resize:bool ->
+  ?background_fps:int ->
+  ?dynamic_resolution:float ->
+  unit ->
+  t
 (** Create a window configuration with specified width, height, and optional
-    title (default: "Mlui") *)
+    title (default: "Mlui").
+
+    While the window is being resized, the view is laid out again at most once
+    every [resize_throttle_ms] milliseconds (default: 50), and once more when
+    resizing settles. In between, the previous frame is stretched to the new
+    size when [stretch_on_resize] is set (default: [true]), otherwise it is
+    left as is.
+
+    While no window has input focus, the application runs at most at
+    [background_fps] frames per second. Without it, unfocused windows keep
+    rendering at full rate. Hidden and minimized windows are never rendered;
+    while every window is hidden the loop only keeps subscriptions running, at
+    [background_fps] or 10 times per second.
+
+    With [dynamic_resolution], the window lowers its render resolution in steps
+    down to that fraction while rendering consecutive frames of it takes
+    longer than a 60 fps budget, and raises it again when there is headroom.
+    The render time is measured up to the point the GPU has finished drawing,
+    not including the wait for vsync, so the window waits for the GPU on
+    each frame it renders. The scale is left alone while the loop is
+    throttled to a background rate. The scene is rendered offscreen and
+    upscaled. Full resolution comes back on the first idle frame. *)